@@ -0,0 +1,4 @@
+
+cl /O2 /std:c11 /nologo /EHsc /Feanimation_bench src/animation_bench.c src/animation.c src/res.c src/pack.c src/linalg.c src/utils.c /Isrc /D_CRT_SECURE_NO_WARNINGS
+
+@echo off
@@ -0,0 +1,4 @@
+
+cl /O2 /std:c11 /experimental:c11atomics /nologo /EHsc /Feaudio_bench src/audio_bench.c src/audio.c src/audio_null.c src/utils.c src/pack.c /Isrc /DMAX_SOUND_COUNT=512 /DSOUND_COMMAND_COUNT=1024 /D_CRT_SECURE_NO_WARNINGS
+
+@echo off
@@ -0,0 +1,4 @@
+
+cl /O2 /std:c11 /nologo /EHsc /Felinalg_bench src/linalg_bench.c src/linalg.c src/utils.c /Isrc /D_CRT_SECURE_NO_WARNINGS
+
+@echo off
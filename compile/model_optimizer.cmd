@@ -0,0 +1,3 @@
+cl /O2 /std:c11 /nologo /EHsc /Femodel_optimizer src/model_optimizer.c src/mesh.c src/pack.c src/utils.c /Isrc /D_CRT_SECURE_NO_WARNINGS
+
+@echo off
@@ -1,4 +1,4 @@
 
-cl /nologo /EHsc /Feobj_parser src/obj_parser.c src/utils.c
+cl /nologo /EHsc /Feobj_parser src/obj_parser.c src/mesh.c src/utils.c
 
 @echo off
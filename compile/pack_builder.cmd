@@ -0,0 +1,4 @@
+
+cl /O2 /std:c11 /nologo /EHsc /Fepack_builder src/pack_builder.c src/utils.c /Isrc /D_CRT_SECURE_NO_WARNINGS
+
+@echo off
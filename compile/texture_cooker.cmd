@@ -0,0 +1,3 @@
+cl /O2 /std:c11 /nologo /EHsc /Fetexture_cooker src/texture_cooker.c src/texture.c src/pack.c src/utils.c /Isrc /D_CRT_SECURE_NO_WARNINGS
+
+@echo off
@@ -1,6 +1,9 @@
 # FIXME: unmodified bones do not get redundantly saved and that breaks
 #        everything because this is a piece of shit parser
 
+# NOTE: every corner gets its own vertex, run model_optimizer on the output to
+#       weld them and order the triangles for the vertex cache
+
 # file format:
 
 """header"""
@@ -22,6 +25,29 @@
 # child counts          [(i)]
 # bone hierarchy (ids)  [[(u)]]
 
+# compressed file format (--compress), keyframes quantized and deduplicated:
+
+"""header"""
+# magic                 "ANMC"
+# vertex count
+# index count
+# bone count
+# frame time count
+# key time count
+# key count
+
+"""data"""
+# vertices, indices, bone ids, weights and inverse bind matrices as above
+
+# frame times           [(f)] every input time stamp, the clips start and end on these
+# shared key times      [(f)] the time stamps left after deduplication
+# per bone key counts   [(I)]
+# per bone bounds       [(3f) min, (3f) extent]
+# keys                  [[(H) key time id, (3H) rotation, (3H) position]]
+
+# child counts          [(I)]
+# bone hierarchy (ids)  [[(I)]]
+
 import xml.etree.ElementTree as ET
 import json
 import struct
@@ -281,6 +307,108 @@ def to_quaternion(mat):
 def to_position(mat):
     return mat[at(3, 0)], mat[at(3, 1)], mat[at(3, 2)], 1.0
 
+POSITION_TOLERANCE = 1e-4
+ROTATION_TOLERANCE = 1e-3 # radians
+
+def nlerp(a, b, blend):
+    if sum(i * j for i, j in zip(a, b)) < 0:
+        b = [ -i for i in b ]
+    res = [ (1.0 - blend) * i + blend * j for i, j in zip(a, b) ]
+    length = math.sqrt(sum(i * i for i in res))
+    return [ i / length for i in res ]
+
+def lerp(a, b, blend):
+    return [ (1.0 - blend) * i + blend * j for i, j in zip(a, b) ]
+
+def angle_between(a, b):
+    dot = abs(sum(i * j for i, j in zip(a, b)))
+    return 2.0 * math.acos(min(dot, 1.0))
+
+def predicts(keys, first, last):
+    t0, p0, r0 = keys[first]
+    t1, p1, r1 = keys[last]
+    for t, p, r in keys[first + 1:last]:
+        blend = (t - t0) / (t1 - t0)
+        position = lerp(p0, p1, blend)
+        if max(abs(i - j) for i, j in zip(position, p)) > POSITION_TOLERANCE:
+            return False
+        if angle_between(nlerp(r0, r1, blend), r) > ROTATION_TOLERANCE:
+            return False
+    return True
+
+# drops keys the runtime reproduces by interpolating their neighbours
+def reduce_keys(keys):
+    if len(keys) < 3:
+        return keys
+
+    kept = [ 0 ]
+    last = 1
+    while last < len(keys) - 1:
+        if not predicts(keys, kept[-1], last + 1):
+            kept.append(last)
+        last += 1
+    kept.append(len(keys) - 1)
+
+    reduced = [ keys[i] for i in kept ]
+    # a bone that never moves keeps only one key
+    _, p0, r0 = reduced[0]
+    _, p1, r1 = reduced[-1]
+    if len(reduced) == 2 and max(abs(i - j) for i, j in zip(p0, p1)) <= POSITION_TOLERANCE \
+            and angle_between(r0, r1) <= ROTATION_TOLERANCE:
+        return reduced[:1]
+    return reduced
+
+# smallest three: sign of the largest component is dropped, its index goes into
+# the top bits of the first two components, the rest are stored in 15 bits each
+def quantize_rotation(rotation):
+    largest = max(range(4), key = lambda i: abs(rotation[i]))
+    sign = -1.0 if rotation[largest] < 0 else 1.0
+    rest = [ sign * rotation[i] for i in range(4) if i != largest ]
+    values = [ int(round((i * math.sqrt(2.0) + 1.0) * 0.5 * 32767)) for i in rest ]
+    values = [ min(max(i, 0), 32767) for i in values ]
+    values[0] |= (largest >> 1) << 15
+    values[1] |= (largest & 1) << 15
+    return values
+
+def quantize_position(position, low, extent):
+    return [ int(round((p - l) / e * 65535)) if e > 0 else 0
+             for p, l, e in zip(position, low, extent) ]
+
+def reduce_frames(bone_frames):
+    bones = []
+    for times, transforms in bone_frames:
+        keys = [ (t, to_position(m)[:3], to_quaternion(m)) for t, m in zip(times, transforms) ]
+        bones.append(reduce_keys(keys))
+
+    key_times = sorted({ t for keys in bones for t, _, _ in keys })
+    return key_times, bones
+
+def write_compressed_frames(f, frame_times, key_times, bones):
+    # frame times
+    f.write(struct.pack("=" + "f" * len(frame_times), *frame_times))
+
+    # shared key times
+    f.write(struct.pack("=" + "f" * len(key_times), *key_times))
+
+    # per bone key counts
+    f.write(struct.pack("=" + "I" * len(bones), *[ len(keys) for keys in bones ]))
+
+    # per bone bounds
+    bounds = []
+    for keys in bones:
+        low = [ min(p[i] for _, p, _ in keys) for i in range(3) ]
+        extent = [ max(p[i] for _, p, _ in keys) - low[i] for i in range(3) ]
+        bounds.append((low, extent))
+        f.write(struct.pack("=ffffff", *low, *extent))
+
+    # keys
+    for keys, (low, extent) in zip(bones, bounds):
+        for t, position, rotation in keys:
+            f.write(struct.pack("=H", key_times.index(t)))
+            f.write(struct.pack("=HHH", *quantize_rotation(rotation)))
+            f.write(struct.pack("=HHH", *quantize_position(position, low, extent)))
+
+
 def transpose(mat):
     res = [0] * 16
     for i in range(4):
@@ -298,12 +426,22 @@ bone_frames = get_frame_data(root)
 skeleton = get_skeleton_data(root)
 
 
+compress = "--compress" in argv[3:]
+
 f = open(argv[2], "wb")
 
 # header
+if compress:
+    f.write(b"ANMC")
 f.write(struct.pack("i", len(mesh_data.vertices)))
 f.write(struct.pack("i", len(mesh_data.indices)))
 f.write(struct.pack("i", len(bone_names)))
+if compress:
+    frame_times = sorted({ t for times, _ in bone_frames for t in times })
+    key_times, bones = reduce_frames(bone_frames)
+    f.write(struct.pack("i", len(frame_times)))
+    f.write(struct.pack("i", len(key_times)))
+    f.write(struct.pack("i", sum(len(keys) for keys in bones)))
 
 # vertices
 for vertex in mesh_data.vertices:
@@ -340,21 +478,25 @@ for ibm in ibms:
     print("ibm:", transpose(ibm))
     f.write(struct.pack("=" + "f" * 16, *transpose(ibm)))
 
-# per bone frame counts
-for bone in bone_frames:
-    f.write(struct.pack("i", len(bone[0])))
-
-# input time stamps
-for bone in bone_frames:
-    f.write(struct.pack("=" + "f" * len(bone[0]), *bone[0]))
-
-# output transforms
-for bone in bone_frames:
-    for transform in bone[1]:
-        position = to_position(transform)
-        rotation = to_quaternion(transform)
-        f.write(struct.pack("=ffff", *position))
-        f.write(struct.pack("=ffff", *rotation))
+if compress:
+    write_compressed_frames(f, frame_times, key_times, bones)
+    print("keys:", sum(len(i[0]) for i in bone_frames), "->", sum(len(keys) for keys in bones))
+else:
+    # per bone frame counts
+    for bone in bone_frames:
+        f.write(struct.pack("i", len(bone[0])))
+
+    # input time stamps
+    for bone in bone_frames:
+        f.write(struct.pack("=" + "f" * len(bone[0]), *bone[0]))
+
+    # output transforms
+    for bone in bone_frames:
+        for transform in bone[1]:
+            position = to_position(transform)
+            rotation = to_quaternion(transform)
+            f.write(struct.pack("=ffff", *position))
+            f.write(struct.pack("=ffff", *rotation))
 
 # child counts
 child_counts = [-1] * len(bone_names)
@@ -7,12 +7,22 @@
 
 #include <stdlib.h>
 #include <pthread.h>
+#include <sched.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <limits.h>
 #include <math.h>
 #include <xmmintrin.h>
 
+/* NOTE: in low latency mode, 5 ms periods with three of them buffered */
+#define LOW_LATENCY_PERIOD_SIZE  (AUDIO_SAMPLES_PER_SECOND / 200)
+#define LOW_LATENCY_PERIOD_COUNT 3
+
+/* in ms, so that `running` is still checked when the device stalls */
+#define POLL_TIMEOUT 100
+
 
 static pthread_t thread;
 static int running = 1;
@@ -21,6 +31,8 @@ static int running = 1;
 static int xrunRecover(snd_pcm_t *handle, int err)
 {
     if (err == -EPIPE) {
+        audioReportXrun();
+
         err = snd_pcm_prepare(handle);
         if (err < 0)
             fprintf(stderr, "Can't recover from underrun, prepare failed: %s\n",
@@ -42,11 +54,198 @@ static int xrunRecover(snd_pcm_t *handle, int err)
 }
 
 
+static void reportDelay(snd_pcm_t *device)
+{
+    snd_pcm_sframes_t delay;
+
+    if (snd_pcm_delay(device, &delay) == 0 && delay >= 0)
+        audioReportLatency((unsigned)delay);
+}
+
+
+static void writeLoop(snd_pcm_t *device, snd_pcm_uframes_t periodSize,
+                      AudioWriteCallback writeCallback, int16_t *writeBuffer)
+{
+    const unsigned int CHANNEL_COUNT = 2;
+
+    while (running) {
+        writeCallback(writeBuffer, periodSize);
+
+        int16_t *framePointer = writeBuffer;
+        uint32_t framesLeft = periodSize;
+
+        while (framesLeft > 0) {
+            int ret = snd_pcm_writei(device, framePointer, framesLeft);
+
+            if (ret == -EAGAIN)
+                continue;
+
+            if (ret < 0) {
+                if (xrunRecover(device, ret) < 0) {
+                    fprintf(stderr, "failed write! error: %s\n", snd_strerror(ret));
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+
+            framePointer += ret * CHANNEL_COUNT;
+            framesLeft -= ret;
+        }
+
+        reportDelay(device);
+    }
+}
+
+
+/* NOTE: for mmap areas that aren't plain interleaved S16 or that wrap around */
+static void copyToAreas(const snd_pcm_channel_area_t *areas, snd_pcm_uframes_t offset,
+                        const int16_t *frames, snd_pcm_uframes_t count)
+{
+    for (int channel = 0; channel < 2; ++channel) {
+        const snd_pcm_channel_area_t *area = areas + channel;
+        char *out = (char *)area->addr + (area->first + offset * area->step) / 8;
+
+        for (snd_pcm_uframes_t i = 0; i < count; ++i)
+            *(int16_t *)(out + i * area->step / 8) = frames[i * 2 + channel];
+    }
+}
+
+
+/* mixes a period straight into the device buffer when it's contiguous */
+static int writePeriod(snd_pcm_t *device, snd_pcm_uframes_t periodSize,
+                       AudioWriteCallback writeCallback, int16_t *writeBuffer)
+{
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset, frames = periodSize;
+
+    int ret = snd_pcm_mmap_begin(device, &areas, &offset, &frames);
+    if (ret < 0)
+        return ret;
+
+    bool direct = frames == periodSize
+               && areas[0].addr == areas[1].addr
+               && areas[0].first == 0 && areas[1].first == 16
+               && areas[0].step == 32 && areas[1].step == 32;
+
+    if (direct) {
+        writeCallback((int16_t *)areas[0].addr + offset * 2, periodSize);
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(device, offset, frames);
+        if (committed < 0)
+            return (int)committed;
+
+        return (snd_pcm_uframes_t)committed == frames ? 0 : -EPIPE;
+    }
+
+    writeCallback(writeBuffer, periodSize);
+
+    for (snd_pcm_uframes_t done = 0; ; ) {
+        copyToAreas(areas, offset, writeBuffer + done * 2, frames);
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(device, offset, frames);
+        if (committed < 0)
+            return (int)committed;
+        if ((snd_pcm_uframes_t)committed != frames)
+            return -EPIPE;
+
+        done += frames;
+        if (done == periodSize)
+            return 0;
+
+        frames = periodSize - done;
+        ret = snd_pcm_mmap_begin(device, &areas, &offset, &frames);
+        if (ret < 0)
+            return ret;
+    }
+}
+
+
+/* NOTE: sleeps in poll until the device has room for a period instead of
+ *       blocking in writei, the device is started once its buffer is full */
+static void mmapLoop(snd_pcm_t *device, snd_pcm_uframes_t periodSize,
+                     AudioWriteCallback writeCallback, int16_t *writeBuffer)
+{
+    int fdCount = snd_pcm_poll_descriptors_count(device);
+    if (fdCount <= 0) {
+        fprintf(stderr, "failed to get poll descriptors count!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct pollfd *fds = malloc(sizeof(struct pollfd) * fdCount);
+    if (!fds) {
+        fprintf(stderr, "failed to allocate memory for poll descriptors!");
+        exit(EXIT_FAILURE);
+    }
+
+    int ret = snd_pcm_poll_descriptors(device, fds, fdCount);
+    if (ret < 0)
+        fprintf(stderr, "failed to get poll descriptors! error: %s\n", snd_strerror(ret));
+
+    while (running) {
+        snd_pcm_state_t state = snd_pcm_state(device);
+
+        if (state == SND_PCM_STATE_XRUN || state == SND_PCM_STATE_SUSPENDED) {
+            ret = xrunRecover(device, state == SND_PCM_STATE_XRUN ? -EPIPE : -ESTRPIPE);
+            if (ret < 0) {
+                fprintf(stderr, "failed to recover! error: %s\n", snd_strerror(ret));
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(device);
+        if (avail < 0) {
+            if (xrunRecover(device, (int)avail) < 0) {
+                fprintf(stderr, "failed avail update! error: %s\n", snd_strerror((int)avail));
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if ((snd_pcm_uframes_t)avail < periodSize) {
+            if (state == SND_PCM_STATE_PREPARED) {
+                ret = snd_pcm_start(device);
+                if (ret < 0)
+                    fprintf(stderr, "failed to start pcm! error: %s\n", snd_strerror(ret));
+                continue;
+            }
+
+            if (poll(fds, fdCount, POLL_TIMEOUT) <= 0)
+                continue;
+
+            /* NOTE: errors show up in the state at the top of the loop */
+            unsigned short revents;
+            snd_pcm_poll_descriptors_revents(device, fds, fdCount, &revents);
+            continue;
+        }
+
+        ret = writePeriod(device, periodSize, writeCallback, writeBuffer);
+        if (ret < 0 && xrunRecover(device, ret) < 0) {
+            fprintf(stderr, "failed mmap write! error: %s\n", snd_strerror(ret));
+            exit(EXIT_FAILURE);
+        }
+
+        reportDelay(device);
+    }
+
+    free(fds);
+}
+
+
 void *startAlsa(void *param)
 {
     AudioInfo *info = (AudioInfo*)param;
     AudioWriteCallback writeCallback = info->writeCallback;
 
+    // Scheduling
+
+    if (info->realTime) {
+        struct sched_param schedParam = { .sched_priority = sched_get_priority_min(SCHED_FIFO) + 10 };
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &schedParam);
+        if (err)
+            fprintf(stderr, "no real-time scheduling for audio! error: %s\n", strerror(err));
+    }
+
     // Open device
 
     const char *deviceName = "default";
@@ -66,13 +265,22 @@ void *startAlsa(void *param)
     if (ret < 0)
         fprintf(stderr, "failed to fill hw_params! error: %s\n", snd_strerror(ret));
 
-    ret = snd_pcm_hw_params_test_access(device, hwParams, SND_PCM_ACCESS_RW_INTERLEAVED);
+    /* NOTE: low latency falls back to writei when mmap isn't there */
+    snd_pcm_access_t pcmAccess = SND_PCM_ACCESS_RW_INTERLEAVED;
+    if (info->lowLatency) {
+        ret = snd_pcm_hw_params_test_access(device, hwParams, SND_PCM_ACCESS_MMAP_INTERLEAVED);
+        if (ret < 0)
+            printf("mmap access not available! error: %s\n", snd_strerror(ret));
+        else
+            pcmAccess = SND_PCM_ACCESS_MMAP_INTERLEAVED;
+    }
+
+    ret = snd_pcm_hw_params_test_access(device, hwParams, pcmAccess);
     if (ret < 0) // NOTE(engine): Maybe handle later
         printf("requested acces not available! error: %s\n", snd_strerror(ret));
-    ret = snd_pcm_hw_params_set_access(device, hwParams, SND_PCM_ACCESS_RW_INTERLEAVED);
+    ret = snd_pcm_hw_params_set_access(device, hwParams, pcmAccess);
     if (ret < 0)
         fprintf(stderr, "failed to set access! error: %s\n", snd_strerror(ret));
-    // TODO: Add support for interupt processing
 
     ret = snd_pcm_hw_params_test_format(device, hwParams, SND_PCM_FORMAT_S16_LE);
     if (ret < 0) // NOTE(engine): Maybe handle later
@@ -110,7 +318,12 @@ void *startAlsa(void *param)
         printf("wrong sample rate!");
     printf("returned sample rate: %d\n", rate);
 
-    const unsigned int BUFFER_SIZE = AUDIO_SAMPLES_PER_SECOND / 10;
+    const unsigned int PERIOD_SIZE = info->periodSize ? info->periodSize
+                                   : info->lowLatency ? LOW_LATENCY_PERIOD_SIZE
+                                   : AUDIO_SAMPLES_PER_SECOND / 40;
+
+    const unsigned int BUFFER_SIZE = info->lowLatency ? PERIOD_SIZE * LOW_LATENCY_PERIOD_COUNT
+                                                      : AUDIO_SAMPLES_PER_SECOND / 10;
     snd_pcm_uframes_t bufferSize = BUFFER_SIZE;
     ret = snd_pcm_hw_params_set_buffer_size_near(device, hwParams, &bufferSize);
     if (ret < 0)
@@ -119,7 +332,6 @@ void *startAlsa(void *param)
         printf("wring buffer size");
     printf("returned buffer size: %ld\n", bufferSize);
 
-    const unsigned int PERIOD_SIZE = AUDIO_SAMPLES_PER_SECOND / 40;
     snd_pcm_uframes_t periodSize = PERIOD_SIZE;
     dir = 0;
     ret = snd_pcm_hw_params_set_period_size_near(device, hwParams, &periodSize, &dir);
@@ -152,7 +364,6 @@ void *startAlsa(void *param)
     ret = snd_pcm_sw_params_set_avail_min(device, swParams, periodSize);
     if (ret < 0)
         fprintf(stderr, "failed to set avail min! error: %s\n", snd_strerror(ret));
-    // TODO(engine): Add support for interupt processing
 
     ret = snd_pcm_sw_params(device, swParams);
     if (ret < 0)
@@ -167,30 +378,10 @@ void *startAlsa(void *param)
         exit(EXIT_FAILURE);
     }
 
-    while (running) {
-        writeCallback(writeBuffer, periodSize);
-
-        int16_t *framePointer = writeBuffer;
-        uint32_t framesLeft = periodSize;
-
-        while (framesLeft > 0) {
-            ret = snd_pcm_writei(device, framePointer, framesLeft);
-
-            if (ret == -EAGAIN)
-                continue;
-
-            if (ret < 0) {
-                if (xrunRecover(device, ret) < 0) {
-                    fprintf(stderr, "failed write! error: %s\n", snd_strerror(ret));
-                    exit(EXIT_FAILURE);
-                }
-                break;
-            }
-
-            framePointer += ret * CHANNEL_COUNT;
-            framesLeft -= ret;
-        }
-    }
+    if (pcmAccess == SND_PCM_ACCESS_MMAP_INTERLEAVED)
+        mmapLoop(device, periodSize, writeCallback, writeBuffer);
+    else
+        writeLoop(device, periodSize, writeCallback, writeBuffer);
 
     snd_pcm_close(device);
 
@@ -0,0 +1,15 @@
+#version 460 core
+
+layout(location = 0) in vec3 o_normals;
+layout(location = 1) in vec2 o_textures;
+
+layout(location = 0) out vec4 o_albedo;
+layout(location = 1) out vec4 o_normal;
+
+layout(binding = 0) uniform sampler2D textureSampler;
+
+void main()
+{
+    o_albedo = vec4(texture(textureSampler, o_textures).rgb, 1.0);
+    o_normal = vec4(normalize(o_normals) * 0.5 + 0.5, 1.0);
+}
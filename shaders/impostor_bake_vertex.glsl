@@ -0,0 +1,17 @@
+#version 460 core
+
+layout(location = 0) in vec3 i_position;
+layout(location = 1) in vec2 i_textures;
+layout(location = 2) in vec3 i_normals;
+
+layout(location = 0) out vec3 o_normals;
+layout(location = 1) out vec2 o_textures;
+
+layout(location = 0) uniform mat4 u_viewMat;
+
+void main() {
+    gl_Position = u_viewMat * vec4(i_position, 1.0);
+
+    o_normals = i_normals;
+    o_textures = i_textures;
+}
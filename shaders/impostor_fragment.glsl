@@ -0,0 +1,62 @@
+#version 460 core
+
+layout(location = 0) in vec2 o_textures0;
+layout(location = 1) in vec2 o_textures1;
+layout(location = 2) in float o_viewBlend;
+layout(location = 3) flat in float o_fade;
+layout(location = 4) in vec3 o_position;
+layout(location = 5) in vec3 o_cameraPos;
+layout(location = 6) flat in mat3 o_normalMat;
+
+layout(location = 0) out vec4 o_color;
+
+layout(binding = 0) uniform sampler2D albedoSampler;
+layout(binding = 1) uniform sampler2D normalSampler;
+
+layout(std140, binding = 1) uniform Env
+{
+    vec4 ambient;
+    vec3 toLight;
+    vec3 sunColor;
+} env;
+
+const float bayer[16] = float[](
+     0.0,  8.0,  2.0, 10.0,
+    12.0,  4.0, 14.0,  6.0,
+     3.0, 11.0,  1.0,  9.0,
+    15.0,  7.0, 13.0,  5.0
+);
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy) % 4;
+    if (o_fade <= (bayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0)
+        discard;
+
+    vec4 albedo = mix(texture(albedoSampler, o_textures0), texture(albedoSampler, o_textures1), o_viewBlend);
+    if (albedo.a < 0.5)
+        discard;
+
+    vec4 packedNormal = mix(texture(normalSampler, o_textures0), texture(normalSampler, o_textures1), o_viewBlend);
+    vec3 normal = normalize(o_normalMat * (packedNormal.xyz / packedNormal.a * 2.0 - 1.0));
+    vec4 texColor = vec4(albedo.rgb / albedo.a, 1.0);
+
+    float brightness = max(dot(normal, env.toLight), 0.0) * 0.9;
+    vec3 lightColor = env.sunColor * brightness;
+
+    vec3 ambientColor = env.ambient.xyz * env.ambient.w;
+
+    vec3 toCamera = normalize(o_cameraPos - o_position);
+    vec3 reflection = normalize(reflect(-env.toLight, normal));
+    float shine = pow(max(dot(toCamera, reflection), 0.0), 32);
+    vec3 specular = shine * 0.5 * lightColor;
+
+    vec4 cleanColor = vec4(ambientColor + lightColor + specular, 1.0)
+                    * texColor;
+
+    float dist = distance(o_position, o_cameraPos);
+    float farDist = 64.0;
+    float ratio = min(dist / farDist, 1.0);
+    o_color = (1.0 - ratio) * cleanColor
+            + ratio         * vec4(ambientColor, 1.0);
+}
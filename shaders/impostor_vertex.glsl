@@ -0,0 +1,68 @@
+#version 460 core
+
+layout(location = 0) out vec2 o_textures0;
+layout(location = 1) out vec2 o_textures1;
+layout(location = 2) out float o_viewBlend;
+layout(location = 3) flat out float o_fade;
+layout(location = 4) out vec3 o_position;
+layout(location = 5) out vec3 o_cameraPos;
+layout(location = 6) flat out mat3 o_normalMat;
+
+layout(location = 0) uniform uint u_modOffset;
+layout(location = 1) uniform vec3 u_bounds;
+layout(location = 2) uniform vec2 u_fadeBand;
+
+layout(std140, binding = 0) uniform Cam
+{
+    mat4 viewMat;
+    mat4 projMat;
+    mat4 vpMat;
+    vec3 pos;
+} cam;
+
+layout(std140, binding = 2) uniform Stats
+{
+    mat4 modMats[1024];
+} stats;
+
+layout(std140, binding = 4) uniform StaticIds
+{
+    uvec4 ids[512];
+} staticIds;
+
+const float VIEW_COUNT = 8.0;
+const float PI = 3.14159265358979;
+
+void main() {
+    uint id = u_modOffset + gl_InstanceID;
+    mat4 modMat = stats.modMats[staticIds.ids[id / 4][id % 4]];
+
+    vec3 center = modMat[3].xyz;
+    float scale = length(modMat[0].xyz);
+
+    vec3 toCamera = cam.pos - center;
+    vec3 right = vec3(toCamera.z, 0.0, -toCamera.x);
+    right = dot(right, right) > 1e-8 ? normalize(right) : vec3(1.0, 0.0, 0.0);
+
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    vec3 position = center
+                  + right * (corner.x * 2.0 - 1.0) * u_bounds.x * scale
+                  + vec3(0.0, mix(u_bounds.y, u_bounds.z, corner.y) * scale, 0.0);
+    gl_Position = cam.vpMat * vec4(position, 1.0);
+
+    vec3 localCamera = (inverse(modMat) * vec4(cam.pos, 1.0)).xyz;
+    float view = mod(atan(localCamera.x, localCamera.z) / (2.0 * PI) * VIEW_COUNT, VIEW_COUNT);
+    float view0 = floor(view);
+    float view1 = mod(view0 + 1.0, VIEW_COUNT);
+
+    o_textures0 = vec2((view0 + corner.x) / VIEW_COUNT, corner.y);
+    o_textures1 = vec2((view1 + corner.x) / VIEW_COUNT, corner.y);
+    o_viewBlend = view - view0;
+
+    o_fade = clamp((length(toCamera) - u_fadeBand.x) / u_fadeBand.y, 0.0, 1.0);
+
+    o_position = position;
+    o_cameraPos = cam.pos;
+    o_normalMat = mat3(modMat) / scale;
+}
@@ -0,0 +1,69 @@
+#version 460 core
+
+layout(location = 0) in vec3  i_position;
+layout(location = 1) in vec3  i_normal;
+layout(location = 2) in vec2  i_texture;
+layout(location = 3) in ivec4 i_ids;
+layout(location = 4) in vec4  i_weights;
+
+layout(location = 0) out vec3 o_normal;
+layout(location = 1) out vec3 o_position;
+layout(location = 2) out vec2 o_texture;
+layout(location = 3) out vec3 o_cameraPos;
+
+/* in vec4s, every instance starts with (scale, 0, 0, 0)
+ * followed by (real, dual) pairs for every bone */
+layout(location = 0) uniform uint u_offset;
+layout(location = 1) uniform uint u_stride;
+
+layout(std140, binding = 3) uniform Animated
+{
+    vec4 vectors[4096];
+} animated;
+
+layout(std140, binding = 0) uniform Cam
+{
+    mat4 viewMat;
+    mat4 projMat;
+    mat4 vpMat;
+    vec3 pos;
+} cam;
+
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main(void)
+{
+    uint base = u_offset + gl_InstanceID * u_stride;
+    float scale = animated.vectors[base].x;
+
+    vec4 first = animated.vectors[base + 1 + 2 * i_ids[0]];
+    vec4 real  = vec4(0.0, 0.0, 0.0, 0.0);
+    vec4 dual  = vec4(0.0, 0.0, 0.0, 0.0);
+
+    for (int i = 0; i < 4; ++i) {
+        uint bone = base + 1 + 2 * i_ids[i];
+        vec4 r = animated.vectors[bone];
+        vec4 d = animated.vectors[bone + 1];
+
+        /* keep all the rotations in the same hemisphere */
+        float weight = dot(first, r) < 0.0 ? -i_weights[i] : i_weights[i];
+        real += r * weight;
+        dual += d * weight;
+    }
+
+    float invLength = 1.0 / length(real);
+    real *= invLength;
+    dual *= invLength;
+
+    vec3 translation = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+    vec3 position = rotate(real, i_position * scale) + translation;
+
+    gl_Position = cam.vpMat * vec4(position, 1.0);
+    o_normal = normalize(rotate(real, i_normal));
+    o_position = position;
+    o_texture = i_texture;
+    o_cameraPos = cam.pos;
+}
@@ -4,6 +4,7 @@ layout(location = 0) in vec3 o_normals;
 layout(location = 1) in vec3 o_position;
 layout(location = 2) in vec2 o_textures;
 layout(location = 3) in vec3 o_cameraPos;
+layout(location = 4) flat in float o_fade;
 
 layout(location = 0) out vec4 o_color;
 
@@ -16,8 +17,19 @@ layout(std140, binding = 1) uniform Env
     vec3 sunColor;
 } env;
 
+const float bayer[16] = float[](
+     0.0,  8.0,  2.0, 10.0,
+    12.0,  4.0, 14.0,  6.0,
+     3.0, 11.0,  1.0,  9.0,
+    15.0,  7.0, 13.0,  5.0
+);
+
 void main()
 {
+    ivec2 pixel = ivec2(gl_FragCoord.xy) % 4;
+    if (o_fade > (bayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0)
+        discard;
+
     vec4 texColor = texture(textureSampler, o_textures);
 
     float brightness = max(dot(o_normals, env.toLight), 0.0) * 0.9;
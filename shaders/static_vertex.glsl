@@ -8,8 +8,10 @@ layout(location = 0) out vec3 o_normals;
 layout(location = 1) out vec3 o_position;
 layout(location = 2) out vec2 o_textures;
 layout(location = 3) out vec3 o_cameraPos;
+layout(location = 4) flat out float o_fade;
 
 layout(location = 0) uniform uint u_modOffset;
+layout(location = 1) uniform vec2 u_fadeBand;
 
 layout(std140, binding = 0) uniform Cam
 {
@@ -24,8 +26,14 @@ layout(std140, binding = 2) uniform Stats
     mat4 modMats[1024];
 } stats;
 
+layout(std140, binding = 4) uniform StaticIds
+{
+    uvec4 ids[512];
+} staticIds;
+
 void main() {
-    mat4 modMat = stats.modMats[u_modOffset + gl_InstanceID];
+    uint id = u_modOffset + gl_InstanceID;
+    mat4 modMat = stats.modMats[staticIds.ids[id / 4][id % 4]];
 
     vec4 position = modMat * vec4(i_position, 1.0);
     gl_Position = cam.vpMat * position;
@@ -35,4 +43,6 @@ void main() {
     o_textures = i_textures;
 
     o_cameraPos = cam.pos;
+
+    o_fade = clamp((distance(modMat[3].xyz, cam.pos) - u_fadeBand.x) / u_fadeBand.y, 0.0, 1.0);
 }
@@ -9,6 +9,11 @@ bool updateAnimation(Animation *animation, float dt)
 
     // FIXME: use fmod
     float loopTime = animation->end - animation->start;
+    if (loopTime <= 0.0f) {
+        animation->time = 0.0f;
+        return false;
+    }
+
     while (animation->time > loopTime) {
         animation->time -= loopTime;
         looped = true;
@@ -18,6 +23,16 @@ bool updateAnimation(Animation *animation, float dt)
 }
 
 
+float getAnimationTime(Animation animation, float ahead)
+{
+    float loopTime = animation.end - animation.start;
+    if (loopTime <= 0.0f)
+        return animation.start;
+
+    return animation.start + fmodf(animation.time + ahead, loopTime);
+}
+
+
 void computeArmatureMatrices(
         Matrix base,
         Matrix *output,
@@ -48,6 +63,34 @@ void computeArmatureMatrices(
 }
 
 
+/* NOTE: `output` ends up in armature space, model transform has to be applied on top */
+void computeArmatureDualQuaternions(
+        DualQuaternion base,
+        DualQuaternion *output,
+        const JointTransform *transforms,
+        const Armature *armature,
+        unsigned index
+) {
+    JointTransform transform = transforms[index];
+
+    /* rotations are stored conjugated, see quaternionToMatrix */
+    DualQuaternion local = dualQuaternionFrom(
+            quaternionConjugate(transform.rotation),
+            transform.position[0],
+            transform.position[1],
+            transform.position[2]
+    );
+
+    base = dualQuaternionMultiply(base, local);
+
+    const unsigned *children = armature->hierarchy + armature->childOffsets[index];
+    for (unsigned i = 0; i < armature->childCounts[index]; ++i)
+        computeArmatureDualQuaternions(base, output, transforms, armature, children[i]);
+
+    output[index] = dualQuaternionMultiply(base, armature->ibdqs[index]);
+}
+
+
 static float getBoneTransforms(
         const Armature *armature,
         JointTransform *first,
@@ -78,18 +121,151 @@ static float getBoneTransforms(
     *first  = armature->transforms[firstOff];
     *second = armature->transforms[secondOff];
 
-    return (time - timeStamps[firstOff]) / (timeStamps[secondOff] - timeStamps[firstOff]);
+    /* NOTE: compressed files keep a single key for bones that never move */
+    if (firstOff == secondOff)
+        return 0.0f;
+
+    float blend = (time - timeStamps[firstOff]) / (timeStamps[secondOff] - timeStamps[firstOff]);
+    return fminf(fmaxf(blend, 0.0f), 1.0f);
 }
 
 
-// TODO: cache per bone positions
-void computePoseTransforms(const Armature *armature, JointTransform *transforms, float time)
+void poseClear(PoseBatch *pose, int boneCount)
+{
+    assert(boneCount <= MAX_POSE_BONES);
+
+    pose->boneCount = boneCount;
+
+    for (int i = 0; i < boneCount; ++i) {
+        pose->px[i] = 0.0f;
+        pose->py[i] = 0.0f;
+        pose->pz[i] = 0.0f;
+        pose->qw[i] = 0.0f;
+        pose->qx[i] = 0.0f;
+        pose->qy[i] = 0.0f;
+        pose->qz[i] = 0.0f;
+    }
+}
+
+
+/* NOTE: unnormalized, only meant to be accumulated or multiplied */
+static void sampleBones(const Armature *armature, float time, PoseBatch *sample)
 {
-    for (int i = 0; i < armature->boneCount; ++i) {
+    for (int i = 0; i < sample->boneCount; ++i) {
         JointTransform first, second;
         float blend = getBoneTransforms(armature, &first, &second, i, time);
+        float blendI = 1.0f - blend;
 
-        transforms[i].rotation = quaternionNLerp(first.rotation, second.rotation, blend);
-        positionLerp(transforms[i].position, first.position, second.position, blend);
+        Quaternion a = first.rotation;
+        Quaternion b = second.rotation;
+        float dot = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+        float blendB = dot < 0.0f ? -blend : blend;
+
+        sample->qw[i] = blendI * a.w + blendB * b.w;
+        sample->qx[i] = blendI * a.x + blendB * b.x;
+        sample->qy[i] = blendI * a.y + blendB * b.y;
+        sample->qz[i] = blendI * a.z + blendB * b.z;
+
+        sample->px[i] = blendI * first.position[0] + blend * second.position[0];
+        sample->py[i] = blendI * first.position[1] + blend * second.position[1];
+        sample->pz[i] = blendI * first.position[2] + blend * second.position[2];
+    }
+}
+
+
+void poseAccumulate(PoseBatch *pose, const Armature *armature, float time, float weight)
+{
+    PoseBatch sample;
+    sample.boneCount = pose->boneCount;
+    sampleBones(armature, time, &sample);
+
+    for (int i = 0; i < pose->boneCount; ++i) {
+        float dot = pose->qw[i] * sample.qw[i] + pose->qx[i] * sample.qx[i]
+                  + pose->qy[i] * sample.qy[i] + pose->qz[i] * sample.qz[i];
+        float w = dot < 0.0f ? -weight : weight;
+
+        pose->qw[i] += w * sample.qw[i];
+        pose->qx[i] += w * sample.qx[i];
+        pose->qy[i] += w * sample.qy[i];
+        pose->qz[i] += w * sample.qz[i];
+
+        pose->px[i] += weight * sample.px[i];
+        pose->py[i] += weight * sample.py[i];
+        pose->pz[i] += weight * sample.pz[i];
+    }
+}
+
+
+/* NOTE: rotations are stored conjugated, so the local space delta conj(ref) * layer
+ *       becomes layer * conj(ref) applied from the left */
+void poseAddLayer(PoseBatch *pose, const Armature *armature, float time, float referenceTime, float weight)
+{
+    PoseBatch layer, reference;
+    layer.boneCount = reference.boneCount = pose->boneCount;
+    sampleBones(armature, time, &layer);
+    sampleBones(armature, referenceTime, &reference);
+
+    for (int i = 0; i < pose->boneCount; ++i) {
+        float lw = layer.qw[i], lx = layer.qx[i], ly = layer.qy[i], lz = layer.qz[i];
+        float rw = reference.qw[i], rx = -reference.qx[i], ry = -reference.qy[i], rz = -reference.qz[i];
+
+        float dw = lw * rw - lx * rx - ly * ry - lz * rz;
+        float dx = lw * rx + lx * rw + ly * rz - lz * ry;
+        float dy = lw * ry - lx * rz + ly * rw + lz * rx;
+        float dz = lw * rz + lx * ry - ly * rx + lz * rw;
+
+        /* nlerp from identity, its dot with the delta is dw */
+        float blend = dw < 0.0f ? -weight : weight;
+        dw = (1.0f - weight) + blend * dw;
+        dx *= blend;
+        dy *= blend;
+        dz *= blend;
+
+        float inverse = 1.0f / sqrtf(dw * dw + dx * dx + dy * dy + dz * dz);
+        dw *= inverse;
+        dx *= inverse;
+        dy *= inverse;
+        dz *= inverse;
+
+        float bw = pose->qw[i], bx = pose->qx[i], by = pose->qy[i], bz = pose->qz[i];
+
+        pose->qw[i] = dw * bw - dx * bx - dy * by - dz * bz;
+        pose->qx[i] = dw * bx + dx * bw + dy * bz - dz * by;
+        pose->qy[i] = dw * by - dx * bz + dy * bw + dz * bx;
+        pose->qz[i] = dw * bz + dx * by - dy * bx + dz * bw;
+
+        pose->px[i] += weight * (layer.px[i] - reference.px[i]);
+        pose->py[i] += weight * (layer.py[i] - reference.py[i]);
+        pose->pz[i] += weight * (layer.pz[i] - reference.pz[i]);
     }
 }
+
+
+void poseStore(const PoseBatch *pose, JointTransform *transforms)
+{
+    for (int i = 0; i < pose->boneCount; ++i) {
+        float length = sqrtf(pose->qw[i] * pose->qw[i] + pose->qx[i] * pose->qx[i]
+                           + pose->qy[i] * pose->qy[i] + pose->qz[i] * pose->qz[i]);
+        float inverse = length > 0.0f ? 1.0f / length : 0.0f;
+
+        transforms[i] = (JointTransform) {
+            .position = { pose->px[i], pose->py[i], pose->pz[i], 1.0f },
+            .rotation = {{
+                pose->qw[i] * inverse,
+                pose->qx[i] * inverse,
+                pose->qy[i] * inverse,
+                pose->qz[i] * inverse
+            }},
+        };
+    }
+}
+
+
+void computePoseTransforms(const Armature *armature, JointTransform *transforms, float time)
+{
+    static PoseBatch pose;
+
+    poseClear(&pose, armature->boneCount);
+    poseAccumulate(&pose, armature, time, 1.0f);
+    poseStore(&pose, transforms);
+}
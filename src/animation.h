@@ -14,7 +14,36 @@ typedef struct
 } Animation;
 
 
+#define MAX_POSE_BONES 128
+
+/* Blended pose in SoA form. Clips are accumulated weighted and unnormalized,
+ * additive layers go on top of that and `poseStore` normalizes once per bone,
+ * so a crossfade costs about as much as sampling a single clip. */
+typedef struct
+{
+    int boneCount;
+
+    float px[MAX_POSE_BONES];
+    float py[MAX_POSE_BONES];
+    float pz[MAX_POSE_BONES];
+
+    float qw[MAX_POSE_BONES];
+    float qx[MAX_POSE_BONES];
+    float qy[MAX_POSE_BONES];
+    float qz[MAX_POSE_BONES];
+} PoseBatch;
+
+
 bool updateAnimation(Animation *animation, float dt);
+/* armature time of `animation` advanced by `ahead`, wrapped around the clip */
+float getAnimationTime(Animation animation, float ahead);
+
+void poseClear(PoseBatch *pose, int boneCount);
+/* NOTE: weights of the accumulated clips should sum up to one */
+void poseAccumulate(PoseBatch *pose, const Armature *armature, float time, float weight);
+/* adds the difference between `time` and `referenceTime`, after all accumulated clips */
+void poseAddLayer(PoseBatch *pose, const Armature *armature, float time, float referenceTime, float weight);
+void poseStore(const PoseBatch *pose, JointTransform *transforms);
 
 void computePoseTransforms(const Armature *armature, JointTransform *transforms, float time);
 
@@ -26,4 +55,12 @@ void computeArmatureMatrices(
         unsigned index
 );
 
+void computeArmatureDualQuaternions(
+        DualQuaternion base,
+        DualQuaternion *output,
+        const JointTransform *transforms,
+        const Armature *armature,
+        unsigned index
+);
+
 #endif
@@ -0,0 +1,171 @@
+#include "animation.h"
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* usage: animation_bench
+ *
+ * NOTE: run from the game directory, it reads the mobs' armatures from res/ */
+
+#define BENCH_POSES 4096
+#define BENCH_RUNS  20
+
+/* NOTE: sampled keys are lerped, not normalized, so the batch drifts a little off the reference */
+#define POSITION_TOLERANCE 1e-4f
+#define ROTATION_TOLERANCE 1e-2f
+
+static const char *armaturePaths[] = {
+    "res/worm.animated",
+    "res/brug.animated",
+};
+
+typedef struct
+{
+    float baseTime;
+    float fadeTime;
+    float fade;
+    float layerTime;
+    float referenceTime;
+    float weight;
+} PoseParams;
+
+static PoseParams params[BENCH_POSES];
+
+static JointTransform output[MAX_POSE_BONES];
+static JointTransform expect[MAX_POSE_BONES];
+static JointTransform layer [MAX_POSE_BONES];
+static JointTransform reference[MAX_POSE_BONES];
+
+static PoseBatch pose;
+
+
+static float randomFloat(float min, float max)
+{
+    return min + (max - min) * ((float)rand() / RAND_MAX);
+}
+
+
+static void computeBatch(const Armature *armature, PoseParams p)
+{
+    poseClear(&pose, armature->boneCount);
+    poseAccumulate(&pose, armature, p.fadeTime, 1.0f - p.fade);
+    poseAccumulate(&pose, armature, p.baseTime, p.fade);
+    poseAddLayer(&pose, armature, p.layerTime, p.referenceTime, p.weight);
+    poseStore(&pose, output);
+}
+
+
+/* the same pose a bone at a time, out of normalized single clip poses */
+static void computeReference(const Armature *armature, PoseParams p)
+{
+    computePoseTransforms(armature, expect, p.fadeTime);
+    computePoseTransforms(armature, layer, p.baseTime);
+
+    for (int i = 0; i < armature->boneCount; ++i) {
+        expect[i].rotation = quaternionNLerp(expect[i].rotation, layer[i].rotation, p.fade);
+        for (int k = 0; k < 3; ++k)
+            expect[i].position[k] += p.fade * (layer[i].position[k] - expect[i].position[k]);
+    }
+
+    computePoseTransforms(armature, layer, p.layerTime);
+    computePoseTransforms(armature, reference, p.referenceTime);
+
+    for (int i = 0; i < armature->boneCount; ++i) {
+        Quaternion delta = quaternionMultiply(layer[i].rotation, quaternionConjugate(reference[i].rotation));
+        delta = quaternionNLerp((Quaternion) {{ 1.0f, 0.0f, 0.0f, 0.0f }}, delta, p.weight);
+
+        expect[i].rotation = quaternionMultiply(delta, expect[i].rotation);
+        for (int k = 0; k < 3; ++k)
+            expect[i].position[k] += p.weight * (layer[i].position[k] - reference[i].position[k]);
+    }
+}
+
+
+static void measureError(int boneCount, float *position, float *rotation)
+{
+    for (int i = 0; i < boneCount; ++i) {
+        for (int k = 0; k < 3; ++k)
+            *position = fmaxf(*position, fabsf(output[i].position[k] - expect[i].position[k]));
+
+        Quaternion a = output[i].rotation;
+        Quaternion b = expect[i].rotation;
+        float dot = fabsf(a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z);
+        *rotation = fmaxf(*rotation, 2.0f * acosf(fminf(dot, 1.0f)));
+    }
+}
+
+
+static void report(const char *name, int boneCount, double seconds)
+{
+    printf("  %-20s %8.2f ns/pose %8.2f ns/bone\n", name,
+            seconds * 1e9 / ((double)BENCH_RUNS * BENCH_POSES),
+            seconds * 1e9 / ((double)BENCH_RUNS * BENCH_POSES * boneCount));
+}
+
+
+int main(void)
+{
+    srand(666);
+
+    bool failed = false;
+
+    for (size_t path = 0; path < length(armaturePaths); ++path) {
+        Animated animated = animatedLoad(armaturePaths[path]);
+        const Armature *armature = &animated.armature;
+
+        float start = armature->keyTimes[0];
+        float end   = armature->keyTimes[armature->keyTimeCount - 1];
+
+        for (int i = 0; i < BENCH_POSES; ++i) {
+            params[i] = (PoseParams) {
+                .baseTime      = randomFloat(start, end),
+                .fadeTime      = randomFloat(start, end),
+                .fade          = randomFloat(0.0f, 1.0f),
+                .layerTime     = randomFloat(start, end),
+                .referenceTime = randomFloat(start, end),
+                .weight        = randomFloat(0.0f, 1.0f),
+            };
+        }
+
+        /* NOTE: a layer at its own reference, or with no weight, leaves the pose alone */
+        params[0].referenceTime = params[0].layerTime;
+        params[1].weight = 0.0f;
+
+        float positionError = 0.0f, rotationError = 0.0f;
+
+        for (int i = 0; i < BENCH_POSES; ++i) {
+            computeBatch(armature, params[i]);
+            computeReference(armature, params[i]);
+            measureError(armature->boneCount, &positionError, &rotationError);
+        }
+
+        printf("%s: %d bones, crossfade and additive layer, max error position %g rotation %g rad\n",
+                armaturePaths[path], armature->boneCount, positionError, rotationError);
+
+        double time = monotonicSeconds();
+        for (int run = 0; run < BENCH_RUNS; ++run)
+            for (int i = 0; i < BENCH_POSES; ++i)
+                computeReference(armature, params[i]);
+        report("bone at a time", armature->boneCount, monotonicSeconds() - time);
+
+        time = monotonicSeconds();
+        for (int run = 0; run < BENCH_RUNS; ++run)
+            for (int i = 0; i < BENCH_POSES; ++i)
+                computeBatch(armature, params[i]);
+        report("batch", armature->boneCount, monotonicSeconds() - time);
+
+        if (positionError > POSITION_TOLERANCE || rotationError > ROTATION_TOLERANCE)
+            failed = true;
+
+        animatedFree(animated);
+    }
+
+    if (failed) {
+        fprintf(stderr, "batched poses strayed past the tolerance!\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "arena.h"
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static size_t alignSize(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+
+void arenaInit(Arena *arena, const char *name, size_t capacity)
+{
+    capacity = alignSize(capacity);
+
+    /* NOTE: malloc only promises 16 bytes, the base is aligned by hand */
+    void *block = malloc(capacity + ARENA_ALIGNMENT);
+    malloc_check(block);
+
+    *arena = (Arena) {
+        .name     = name,
+        .base     = (uint8_t *)alignSize((uintptr_t)block),
+        .block    = block,
+        .capacity = capacity,
+    };
+}
+
+
+void arenaFree(Arena *arena)
+{
+    free(arena->block);
+
+    *arena = (Arena) { .name = arena->name };
+}
+
+
+void *arenaAlloc(Arena *arena, size_t size)
+{
+    size_t offset = alignSize(arena->used);
+
+    if (offset > arena->capacity || size > arena->capacity - offset) {
+        fprintf(stderr, "%s:%d: %s arena is full! %zu bytes wanted, %zu of %zu used.\n",
+                __FILE__, __LINE__, arena->name, size, arena->used, arena->capacity);
+        exit(666);
+    }
+
+    arena->used = offset + size;
+    if (arena->used > arena->peak)
+        arena->peak = arena->used;
+
+    return arena->base + offset;
+}
+
+
+size_t arenaMark(const Arena *arena)
+{
+    return arena->used;
+}
+
+
+void arenaRewind(Arena *arena, size_t mark)
+{
+    assert(mark <= arena->used);
+
+    arena->used = mark;
+}
+
+
+void arenaReset(Arena *arena)
+{
+    arena->used = 0;
+}
+
+
+void arenaReport(const Arena *arena)
+{
+    printf("%s arena: %.1f KB used, %.1f KB at most, %.1f KB reserved\n",
+           arena->name, arena->used / 1024.0, arena->peak / 1024.0, arena->capacity / 1024.0);
+}
@@ -0,0 +1,38 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* NOTE: every allocation starts on its own cache line */
+#define ARENA_ALIGNMENT 64
+
+
+/* NOTE: one block taken up front and handed out front to back,
+ *       nothing is freed on its own, the whole arena is reset at once */
+typedef struct
+{
+    const char *name;
+    uint8_t *base;
+    void *block;
+    size_t capacity;
+    size_t used;
+    /* NOTE: the most that was ever used, for sizing the capacity */
+    size_t peak;
+} Arena;
+
+
+void arenaInit(Arena *arena, const char *name, size_t capacity);
+void arenaFree(Arena *arena);
+
+/* NOTE: exits when the arena is full, the memory is not cleared */
+void *arenaAlloc(Arena *arena, size_t size);
+
+/* NOTE: rewinding gives back everything allocated since the mark */
+size_t arenaMark(const Arena *arena);
+void arenaRewind(Arena *arena, size_t mark);
+void arenaReset(Arena *arena);
+
+void arenaReport(const Arena *arena);
+
+#endif
@@ -2,117 +2,953 @@
 
 #include "utils.h"
 #include "state.h"
+#include "linalg.h"
+#include "pack.h"
 
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <threads.h>
+#include <time.h>
 
+#if !defined(AUDIO_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define AUDIO_SSE
+    #include <emmintrin.h>
+#endif
+
+
+typedef enum
+{
+    SoundCommandPlay,
+    SoundCommandStop,
+    SoundCommandVolume,
+    SoundCommandPosition,
+    SoundCommandListener,
+
+    SoundCommandTypeCount
+} SoundCommandType;
+
+typedef struct
+{
+    SoundCommandType type;
+    SoundHandle handle;
+    /* NOTE: -1 for sounds played from memory */
+    int stream;
+    /* NOTE: the mixer frame a sound starts on, ones already mixed mean right away */
+    uint64_t frame;
+    union {
+        Sound sound;
+        struct { float volL, volR; };
+        struct { float x, y, z, yaw; };
+    };
+} SoundCommand;
 
-#define NO_NEXT -1
+static_assert((SOUND_COMMAND_COUNT & (SOUND_COMMAND_COUNT - 1)) == 0,
+              "SOUND_COMMAND_COUNT has to be a power of two");
 
-static int availableHead;
+/* single producer (game thread), single consumer (audioCallback) ring */
+static SoundCommand commands[SOUND_COMMAND_COUNT];
+static atomic_uint  commandHead;
+static atomic_uint  commandTail;
 
-static volatile Sound sounds[MAX_SOUND_COUNT];
+/* NOTE: only touched by the game thread */
+static SoundHandle lastHandle;
 
-static int availableTail;
+/* NOTE: game thread side of the clock, game time `t` is the mixer frame
+ *       t * AUDIO_SAMPLES_PER_SECOND + clockOffset */
+static double clockOffset;
+static bool   clockSet;
 
+/* how much of the drift between the game and the mixer is taken out a step */
+#define AUDIO_CLOCK_EASING (1.0 / 256.0)
 
-bool playSound(Sound sound)
+typedef struct
 {
-    int next = sounds[availableHead].next;
-    if (next == NO_NEXT)
-        return false;
+    Sound sound;
+    SoundHandle handle;
+
+    /* NOTE: recomputed every callback, virtual voices aren't mixed */
+    float gainL, gainR;
+    bool mixed;
+
+    int stream;
+    bool starved;
+
+    /* NOTE: in samples, a scheduled voice stays silent until it runs out */
+    size_t delay;
+
+    /* NOTE: the last ADPCM block decoded, consecutive chunks mostly hit it */
+    size_t decodedBlock;
+    int16_t decoded[ADPCM_BLOCK_FRAMES * 2];
+} Voice;
+
+/* NOTE: owned by audioCallback, active voices are kept dense */
+static Voice voices[MAX_VOICE_COUNT];
+static int   voiceCount;
+
+static struct { float x, y, z, yaw; } listener;
+
+typedef enum
+{
+    /* only the game thread takes free streams */
+    StreamFree,
+    /* filled by the I/O thread, drained by audioCallback */
+    StreamPlaying,
+    /* the I/O thread closes it and frees it */
+    StreamDone,
+
+    StreamStateCount
+} StreamState;
+
+static_assert((STREAM_BUFFER_FRAMES & (STREAM_BUFFER_FRAMES - 1)) == 0,
+              "STREAM_BUFFER_FRAMES has to be a power of two");
+
+typedef struct
+{
+    atomic_int state;
+
+    /* NOTE: only touched by whoever fills the stream */
+    FILE *file;
+    long dataOffset;
+    size_t frameCount, filePos;
+    unsigned times;
+    int channelCount;
+
+    /* single producer (I/O thread), single consumer (audioCallback) ring, in frames */
+    int16_t buffer[STREAM_BUFFER_FRAMES * 2];
+    atomic_uint writeFrame;
+    atomic_uint readFrame;
+    /* set once the last frame is in the ring */
+    atomic_bool ended;
+} Stream;
+
+static Stream streams[MAX_STREAM_COUNT];
+static thrd_t streamThread;
+static atomic_bool streamsRunning;
+static atomic_uint streamUnderruns;
+
+/* NOTE: the audio thread's side of AudioStats, times in ns and peaks in samples */
+static atomic_uint outputLatencyFrames;
+static atomic_uint xrunCount;
+static atomic_uint mixTime;
+static atomic_uint mixTimeMax;
+static atomic_uint periodFrames;
+static atomic_int  statVoiceCount;
+static atomic_int  statMixedVoiceCount;
+static atomic_uint peakL, peakR;
+
+/* frames mixed since initAudio, the first frame of the next period */
+static atomic_ullong mixedFrames;
+
+
+static bool pushCommand(SoundCommand command)
+{
+    unsigned head = atomic_load_explicit(&commandHead, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&commandTail, memory_order_acquire);
 
-    sounds[availableHead] = sound;
+    if (head - tail == SOUND_COMMAND_COUNT)
+        return false;
 
-    availableHead = next;
+    commands[head & (SOUND_COMMAND_COUNT - 1)] = command;
+    atomic_store_explicit(&commandHead, head + 1, memory_order_release);
 
     return true;
 }
 
 
+static uint64_t scheduleFrame(double time)
+{
+    if (time == 0.0 || !clockSet)
+        return 0;
+
+    /* NOTE: past the period the mixer may be working on when the command arrives */
+    double frame = time * AUDIO_SAMPLES_PER_SECOND + clockOffset + SOUND_SCHEDULE_MARGIN
+                 + atomic_load_explicit(&periodFrames, memory_order_relaxed);
+
+    return frame > 0.0 ? (uint64_t)frame : 0;
+}
+
+
+static SoundHandle pushSound(Sound sound, int stream)
+{
+    SoundHandle handle = ++lastHandle;
+    if (handle == NO_SOUND)
+        handle = ++lastHandle;
+
+    SoundCommand command = {
+        .type   = SoundCommandPlay,
+        .handle = handle,
+        .stream = stream,
+        .frame  = scheduleFrame(sound.time),
+        .sound  = sound,
+    };
+
+    if (!pushCommand(command))
+        return NO_SOUND;
+
+    return handle;
+}
+
+
+SoundHandle playSound(Sound sound)
+{
+    return pushSound(sound, -1);
+}
+
+
+bool stopSound(SoundHandle handle)
+{
+    return pushCommand((SoundCommand) { .type = SoundCommandStop, .handle = handle });
+}
+
+
+bool setSoundVolume(SoundHandle handle, float volL, float volR)
+{
+    return pushCommand((SoundCommand) {
+        .type   = SoundCommandVolume,
+        .handle = handle,
+        .volL   = volL,
+        .volR   = volR,
+    });
+}
+
+
+bool setSoundPosition(SoundHandle handle, float x, float y, float z)
+{
+    return pushCommand((SoundCommand) {
+        .type   = SoundCommandPosition,
+        .handle = handle,
+        .x      = x,
+        .y      = y,
+        .z      = z,
+    });
+}
+
+
+bool setSoundListener(float x, float y, float z, float yaw)
+{
+    return pushCommand((SoundCommand) {
+        .type = SoundCommandListener,
+        .x    = x,
+        .y    = y,
+        .z    = z,
+        .yaw  = yaw,
+    });
+}
+
+
+/* NOTE: the mixed frame count only moves a period at a time, easing the
+ *       offset towards it averages that out */
+void setAudioClock(double time)
+{
+    double frame  = (double)atomic_load_explicit(&mixedFrames, memory_order_relaxed);
+    double offset = frame - time * AUDIO_SAMPLES_PER_SECOND;
+
+    if (!clockSet || fabs(offset - clockOffset) > AUDIO_CLOCK_TOLERANCE) {
+        clockOffset = offset;
+        clockSet    = true;
+    } else {
+        clockOffset += (offset - clockOffset) * AUDIO_CLOCK_EASING;
+    }
+}
+
+
+static int findVoice(SoundHandle handle)
+{
+    for (int i = 0; i < voiceCount; ++i)
+        if (voices[i].handle == handle)
+            return i;
+
+    return -1;
+}
+
+
+static void releaseStream(int stream)
+{
+    if (stream >= 0)
+        atomic_store_explicit(&streams[stream].state, StreamDone, memory_order_release);
+}
+
+
+static void removeVoice(int index)
+{
+    releaseStream(voices[index].stream);
+    voices[index] = voices[--voiceCount];
+}
+
+
+static float voiceAudibility(const Voice *voice)
+{
+    return voice->gainL > voice->gainR ? voice->gainL : voice->gainR;
+}
+
+
+/* NOTE: lower priority first, quieter first among equal priorities */
+static int compareVoices(const Voice *a, const Voice *b)
+{
+    if (a->sound.priority != b->sound.priority)
+        return a->sound.priority < b->sound.priority ? -1 : 1;
+
+    float x = voiceAudibility(a);
+    float y = voiceAudibility(b);
+    return (x > y) - (x < y);
+}
+
+
+static void addVoice(const Sound *sound, SoundHandle handle, int stream, size_t delay)
+{
+    int index = voiceCount;
+
+    if (voiceCount == MAX_VOICE_COUNT) {
+        index = 0;
+        for (int i = 1; i < voiceCount; ++i)
+            if (compareVoices(voices + i, voices + index) < 0)
+                index = i;
+
+        /* NOTE: only steals from voices that aren't more important */
+        if (voices[index].sound.priority > sound->priority) {
+            releaseStream(stream);
+            return;
+        }
+
+        releaseStream(voices[index].stream);
+    } else {
+        ++voiceCount;
+    }
+
+    voices[index] = (Voice) {
+        .sound        = *sound,
+        .handle       = handle,
+        .stream       = stream,
+        .delay        = delay,
+        .decodedBlock = SIZE_MAX,
+    };
+}
+
+
+static void processCommands(void)
+{
+    unsigned tail = atomic_load_explicit(&commandTail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&commandHead, memory_order_acquire);
+
+    uint64_t frame = atomic_load_explicit(&mixedFrames, memory_order_relaxed);
+
+    for (; tail != head; ++tail) {
+        const SoundCommand *command = commands + (tail & (SOUND_COMMAND_COUNT - 1));
+        int voice;
+
+        switch (command->type) {
+            case SoundCommandPlay:
+                addVoice(&command->sound, command->handle, command->stream,
+                         command->frame > frame ? (size_t)(command->frame - frame) * 2 : 0);
+                break;
+
+            case SoundCommandStop:
+                if ((voice = findVoice(command->handle)) >= 0)
+                    removeVoice(voice);
+                break;
+
+            case SoundCommandVolume:
+                if ((voice = findVoice(command->handle)) >= 0) {
+                    voices[voice].sound.volL = command->volL;
+                    voices[voice].sound.volR = command->volR;
+                }
+                break;
+
+            case SoundCommandPosition:
+                if ((voice = findVoice(command->handle)) >= 0) {
+                    voices[voice].sound.x = command->x;
+                    voices[voice].sound.y = command->y;
+                    voices[voice].sound.z = command->z;
+                }
+                break;
+
+            case SoundCommandListener:
+                listener.x   = command->x;
+                listener.y   = command->y;
+                listener.z   = command->z;
+                listener.yaw = command->yaw;
+                break;
+
+            default:
+                unreachable();
+        }
+    }
+
+    atomic_store_explicit(&commandTail, tail, memory_order_release);
+}
+
+
+/* NOTE: `count` in samples, even so that the gain lanes stay on their channels */
+static void mixSamples(float *bus, const int16_t *in, size_t count, float volL, float volR)
+{
+    size_t i = 0;
+
+#ifdef AUDIO_SSE
+    __m128 gain = _mm_setr_ps(volL, volR, volL, volR);
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+        __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+
+        _mm_storeu_ps(bus + i,     _mm_add_ps(_mm_loadu_ps(bus + i),     _mm_mul_ps(lo, gain)));
+        _mm_storeu_ps(bus + i + 4, _mm_add_ps(_mm_loadu_ps(bus + i + 4), _mm_mul_ps(hi, gain)));
+    }
+#endif
+
+    for (; i < count; i += 2) {
+        bus[i + 0] += in[i + 0] * volL;
+        bus[i + 1] += in[i + 1] * volR;
+    }
+}
+
+
+/* saturates instead of wrapping around when loud voices add up */
+static void writeMixBus(int16_t *out, const float *bus, size_t count, float volume)
+{
+    size_t i = 0;
+
+#ifdef AUDIO_SSE
+    __m128 gain = _mm_set1_ps(volume);
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(bus + i),     gain));
+        __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(bus + i + 4), gain));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(lo, hi));
+    }
+#endif
+
+    for (; i < count; ++i)
+        out[i] = (int16_t)lrintf(fminf(fmaxf(bus[i] * volume, INT16_MIN), INT16_MAX));
+}
+
+
+static const int16_t adpcmSteps[89] = {
+        7,     8,     9,    10,    11,    12,    13,    14,    16,    17,
+       19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+       50,    55,    60,    66,    73,    80,    88,    97,   107,   118,
+      130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+      337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+      876,   963,  1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+     2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+     5894,  6484,  7132,  7845,  8630,  9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+static const int8_t adpcmIndexSteps[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+
+/* NOTE: the step and index updates of every index and code folded into one
+ *       lookup each, so the decoder's dependency chain is a load and an add */
+static int32_t adpcmDeltas [89 * 16];
+static uint16_t adpcmIndices[89 * 16];
+
+
+static void buildADPCMTables(void)
+{
+    for (int index = 0; index < 89; ++index) {
+        for (int code = 0; code < 16; ++code) {
+            /* the multiply form of the IMA step */
+            int delta = ((2 * (code & 7) + 1) * adpcmSteps[index]) >> 3;
+            int next  = index + adpcmIndexSteps[code];
+
+            adpcmDeltas [index * 16 + code] = code & 8 ? -delta : delta;
+            adpcmIndices[index * 16 + code] = (uint16_t)((next < 0 ? 0 : next > 88 ? 88 : next) * 16);
+        }
+    }
+}
+
+
+/* NOTE: sounds may be encoded on loader threads, the mixer only reads the tables
+ *       after initAudio built them */
+static void initADPCM(void)
+{
+    static once_flag once = ONCE_FLAG_INIT;
+    call_once(&once, buildADPCMTables);
+}
+
+
+/* NOTE: `index` is premultiplied by 16 */
+static inline int adpcmStep(int *predictor, int *index, int code)
+{
+    *predictor += adpcmDeltas[*index + code];
+    *predictor  = *predictor < INT16_MIN ? INT16_MIN : *predictor > INT16_MAX ? INT16_MAX : *predictor;
+
+    *index = adpcmIndices[*index + code];
+
+    return *predictor;
+}
+
+
+/* NOTE: both channels are decoded in the same loop, their dependency chains interleave */
+static void decodeADPCMBlock(int16_t *out, const uint8_t *block)
+{
+    int predictorL = (int16_t)(block[0] | block[1] << 8), indexL = block[2] * 16;
+    int predictorR = (int16_t)(block[4] | block[5] << 8), indexR = block[6] * 16;
+
+    const uint8_t *codes = block + 8;
+
+    for (int i = 0; i < ADPCM_BLOCK_FRAMES; ++i) {
+        out[i * 2 + 0] = (int16_t)adpcmStep(&predictorL, &indexL, codes[i] & 0xf);
+        out[i * 2 + 1] = (int16_t)adpcmStep(&predictorR, &indexR, codes[i] >> 4);
+    }
+}
+
+
+uint8_t *encodeADPCM(const int16_t *samples, uint64_t length)
+{
+    size_t frameCount = length / 2;
+    size_t blockCount = (frameCount + ADPCM_BLOCK_FRAMES - 1) / ADPCM_BLOCK_FRAMES;
+
+    uint8_t *blocks = calloc(blockCount ? blockCount : 1, ADPCM_BLOCK_SIZE);
+    malloc_check(blocks);
+
+    initADPCM();
+
+    int predictors[2] = { 0 }, indices[2] = { 0 };
+
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+        uint8_t *block = blocks + frame / ADPCM_BLOCK_FRAMES * ADPCM_BLOCK_SIZE;
+        size_t offset  = frame % ADPCM_BLOCK_FRAMES;
+
+        for (int channel = 0; channel < 2; ++channel) {
+            /* the decoder picks up from the state at the start of every block */
+            if (offset == 0) {
+                block[channel * 4 + 0] = (uint8_t)(predictors[channel] & 0xff);
+                block[channel * 4 + 1] = (uint8_t)((predictors[channel] >> 8) & 0xff);
+                block[channel * 4 + 2] = (uint8_t)(indices[channel] / 16);
+            }
+
+            int delta = samples[frame * 2 + channel] - predictors[channel];
+            int code  = delta < 0 ? 8 : 0;
+            int size  = 4 * (delta < 0 ? -delta : delta) / adpcmSteps[indices[channel] / 16];
+
+            code |= size > 7 ? 7 : size;
+
+            adpcmStep(predictors + channel, indices + channel, code);
+            block[8 + offset] |= (uint8_t)(code << (channel * 4));
+        }
+    }
+
+    return blocks;
+}
+
+
+/* NOTE: `pos` and `count` in samples, even */
+static void mixBlocks(Voice *voice, float *bus, size_t pos, size_t count, float gainL, float gainR)
+{
+    while (count) {
+        size_t frame  = pos / 2;
+        size_t block  = frame / ADPCM_BLOCK_FRAMES;
+        size_t offset = frame % ADPCM_BLOCK_FRAMES;
+
+        if (voice->decodedBlock != block) {
+            decodeADPCMBlock(voice->decoded, voice->sound.blocks + block * ADPCM_BLOCK_SIZE);
+            voice->decodedBlock = block;
+        }
+
+        size_t left  = (ADPCM_BLOCK_FRAMES - offset) * 2;
+        size_t toMix = left < count ? left : count;
+
+        mixSamples(bus, voice->decoded + offset * 2, toMix, gainL, gainR);
+
+        bus   += toMix;
+        pos   += toMix;
+        count -= toMix;
+    }
+}
+
+
+/* NOTE: `bus` NULL only advances the sound, as virtual voices do */
+static void mixVoice(Voice *voice, float *bus, size_t size)
+{
+    Sound *sound = &voice->sound;
+
+    /* NOTE: an empty range would never finish looping */
+    if (sound->start >= sound->end)
+        sound->times = 0;
+
+    size_t written = 0;
+
+    while (written < size && sound->times) {
+        size_t left    = sound->end - sound->pos;
+        size_t toWrite = left < size - written ? left : size - written;
+
+        if (bus && sound->blocks)
+            mixBlocks(voice, bus + written, sound->pos, toWrite, voice->gainL, voice->gainR);
+        else if (bus)
+            mixSamples(bus + written, sound->data + sound->pos, toWrite, voice->gainL, voice->gainR);
+
+        sound->pos += toWrite;
+        written    += toWrite;
+
+        if (sound->pos == sound->end) {
+            sound->pos = sound->start;
+
+            if (sound->times != TIMES_INF)
+                --sound->times;
+        }
+    }
+}
+
+
+/* NOTE: `bus` NULL only consumes the frames, a stream that ran out of frames
+ *       before its end is counted once per callback as an underrun */
+static void mixStream(Voice *voice, float *bus, size_t size, float gainL, float gainR)
+{
+    Stream *stream = streams + voice->stream;
+
+    /* NOTE: `ended` first, so that once set the write position is final */
+    bool ended     = atomic_load_explicit(&stream->ended, memory_order_acquire);
+    unsigned write = atomic_load_explicit(&stream->writeFrame, memory_order_acquire);
+    unsigned read  = atomic_load_explicit(&stream->readFrame, memory_order_relaxed);
+
+    size_t frames    = size / 2;
+    size_t available = write - read;
+    size_t toMix     = available < frames ? available : frames;
+
+    for (size_t done = 0; done < toMix; ) {
+        size_t index = (read + done) & (STREAM_BUFFER_FRAMES - 1);
+        size_t count = STREAM_BUFFER_FRAMES - index < toMix - done ? STREAM_BUFFER_FRAMES - index : toMix - done;
+
+        if (bus)
+            mixSamples(bus + done * 2, stream->buffer + index * 2, count * 2, gainL, gainR);
+
+        done += count;
+    }
+
+    atomic_store_explicit(&stream->readFrame, read + (unsigned)toMix, memory_order_release);
+
+    if (toMix == frames)
+        return;
+
+    if (ended) {
+        voice->sound.times = 0;
+    } else if (!voice->starved) {
+        voice->starved = true;
+        atomic_fetch_add_explicit(&streamUnderruns, 1, memory_order_relaxed);
+    }
+}
+
+
+static void computeGains(Voice *voice)
+{
+    const Sound *sound = &voice->sound;
+
+    voice->gainL = sound->volL;
+    voice->gainR = sound->volR;
+
+    if (!sound->positional)
+        return;
+
+    float dx = sound->x - listener.x;
+    float dy = sound->y - listener.y;
+    float dz = sound->z - listener.z;
+    float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+    if (distance >= sound->radius) {
+        voice->gainL = voice->gainR = 0.0f;
+        return;
+    }
+
+    /* inverse distance past the reference, faded out to nothing at the radius */
+    float attenuation = distance > SOUND_REF_DISTANCE ? SOUND_REF_DISTANCE / distance : 1.0f;
+    attenuation *= 1.0f - distance / sound->radius;
+
+    /* NOTE: the right of a camera looking down sin(yaw), -cos(yaw) on the xz plane,
+     *       panning is eased towards the center inside the reference distance */
+    float pan = 0.0f;
+    if (distance > 0.0f) {
+        pan = (dx * cosf(listener.yaw) + dz * sinf(listener.yaw)) / distance;
+        if (distance < SOUND_REF_DISTANCE)
+            pan *= distance / SOUND_REF_DISTANCE;
+    }
+
+    /* constant power, unity in the center */
+    voice->gainL *= attenuation * sqrtf(1.0f - pan);
+    voice->gainR *= attenuation * sqrtf(1.0f + pan);
+}
+
+
+static int compareMixedVoices(const void *a, const void *b)
+{
+    return compareVoices(voices + *(const int *)b, voices + *(const int *)a);
+}
+
+
+/* picks the most important audible voices to mix, the rest only advance */
+/* NOTE: `size` in samples, returns how many get mixed */
+static int selectVoices(size_t size)
+{
+    static int audible[MAX_VOICE_COUNT];
+    int audibleCount = 0;
+
+    for (int voice = 0; voice < voiceCount; ++voice) {
+        computeGains(voices + voice);
+
+        voices[voice].mixed   = voiceAudibility(voices + voice) >= SOUND_AUDIBLE_GAIN
+                             && voices[voice].delay < size;
+        voices[voice].starved = false;
+        if (voices[voice].mixed)
+            audible[audibleCount++] = voice;
+    }
+
+    if (audibleCount <= MAX_SOUND_COUNT)
+        return audibleCount;
+
+    qsort(audible, audibleCount, sizeof(int), compareMixedVoices);
+
+    for (int i = MAX_SOUND_COUNT; i < audibleCount; ++i)
+        voices[audible[i]].mixed = false;
+
+    return MAX_SOUND_COUNT;
+}
+
+
+/* NOTE: `count` in samples, even */
+static void measurePeaks(const float *bus, size_t count, float *left, float *right)
+{
+    for (size_t i = 0; i < count; i += 2) {
+        *left  = fmaxf(*left,  fabsf(bus[i + 0]));
+        *right = fmaxf(*right, fabsf(bus[i + 1]));
+    }
+}
+
+
+static void publishStats(uint64_t start, unsigned size, int mixedVoiceCount, float left, float right)
+{
+    unsigned time = (unsigned)(monotonicNanoseconds() - start);
+
+    atomic_store_explicit(&mixTime, time, memory_order_relaxed);
+    atomic_store_explicit(&periodFrames, size, memory_order_relaxed);
+    atomic_store_explicit(&statVoiceCount, voiceCount, memory_order_relaxed);
+    atomic_store_explicit(&statMixedVoiceCount, mixedVoiceCount, memory_order_relaxed);
+    atomic_store_explicit(&peakL, (unsigned)left, memory_order_relaxed);
+    atomic_store_explicit(&peakR, (unsigned)right, memory_order_relaxed);
+
+    unsigned max = atomic_load_explicit(&mixTimeMax, memory_order_relaxed);
+    while (time > max && !atomic_compare_exchange_weak_explicit(&mixTimeMax, &max, time,
+                                                                memory_order_relaxed,
+                                                                memory_order_relaxed))
+        ;
+}
+
+
 void audioCallback(int16_t *buffer, unsigned size)
 {
+    static float mixBus[MIX_CHUNK_SIZE];
+
+    uint64_t start = monotonicNanoseconds();
+    unsigned frames = size;
+
     size *= 2;
 
-    for (size_t i = 0; i < size; ++i)
-        buffer[i] = 0;
+    processCommands();
+    int mixedVoiceCount = selectVoices(size);
+
+    float volume = appState.volume;
+    float left = 0.0f, right = 0.0f;
+
+    for (size_t chunk = 0; chunk < size; chunk += MIX_CHUNK_SIZE) {
+        size_t chunkSize = size - chunk < MIX_CHUNK_SIZE ? size - chunk : MIX_CHUNK_SIZE;
 
-    int stoppedCount = 0;
+        memset(mixBus, 0, sizeof(float) * chunkSize);
+
+        for (int voice = 0; voice < voiceCount; ++voice) {
+            Voice *v = voices + voice;
+
+            size_t delay = v->delay < chunkSize ? v->delay : chunkSize;
+            v->delay -= delay;
+            if (delay == chunkSize)
+                continue;
 
-    for (int soundID = 0; soundID < MAX_SOUND_COUNT; ++soundID) {
-        Sound sound = sounds[soundID];
+            float *bus = v->mixed ? mixBus + delay : NULL;
 
-        if (sound.stopped) {
-            ++stoppedCount;
-            continue;
+            if (v->stream >= 0)
+                mixStream(v, bus, chunkSize - delay, v->gainL, v->gainR);
+            else
+                mixVoice(v, bus, chunkSize - delay);
         }
 
-        size_t written = 0;
+        measurePeaks(mixBus, chunkSize, &left, &right);
+        writeMixBus(buffer + chunk, mixBus, chunkSize, volume);
+    }
 
-        while (written < size) {
-            size_t left    = sound.end - sound.pos;
-            size_t toWrite = left < size ? left : size;
+    for (int voice = 0; voice < voiceCount; ++voice)
+        if (voices[voice].sound.times == 0)
+            removeVoice(voice--);
 
-            for (size_t i = 0; i < toWrite; i += 2) {
-                buffer[i + 0] += (int16_t)(sound.data[sound.pos + i + 0] * sound.volL * appState.volume);
-                buffer[i + 1] += (int16_t)(sound.data[sound.pos + i + 1] * sound.volR * appState.volume);
-            }
+    atomic_fetch_add_explicit(&mixedFrames, frames, memory_order_relaxed);
 
-            sound.pos += toWrite;
-            written   += toWrite;
+    publishStats(start, frames, mixedVoiceCount, left * volume, right * volume);
+}
 
-            if (left < size) {
-                sound.pos = sound.start;
 
-                if (sound.times == TIMES_INF)
-                    continue;
+static void emptySounds(void)
+{
+    voiceCount = 0;
+    listener.x = listener.y = listener.z = listener.yaw = 0.0f;
+    lastHandle = NO_SOUND;
 
-                --sound.times;
+    atomic_store(&commandHead, 0);
+    atomic_store(&commandTail, 0);
+}
 
-                if (sound.times == 0)
-                    written = size;
-            }
+
+/* reads as much as fits in the ring, looping back to the start of the data `times` times */
+static void fillStream(Stream *stream)
+{
+    int16_t mono[STREAM_READ_FRAMES];
+
+    unsigned write = atomic_load_explicit(&stream->writeFrame, memory_order_relaxed);
+    unsigned read  = atomic_load_explicit(&stream->readFrame, memory_order_acquire);
+
+    while (!atomic_load_explicit(&stream->ended, memory_order_relaxed)) {
+        if (stream->filePos == stream->frameCount) {
+            if (stream->times != TIMES_INF)
+                --stream->times;
+
+            fseek(stream->file, stream->dataOffset, SEEK_SET);
+            stream->filePos = 0;
         }
 
-        if (sound.times == 0) {
-            if (sound.handle)
-                *(sound.handle) = NULL;
+        if (stream->times == 0 || stream->frameCount == 0) {
+            atomic_store_explicit(&stream->ended, true, memory_order_release);
+            break;
+        }
+
+        size_t space = STREAM_BUFFER_FRAMES - (write - read);
+        size_t index = write & (STREAM_BUFFER_FRAMES - 1);
+        size_t count = stream->frameCount - stream->filePos;
+
+        if (count > space)
+            count = space;
+        if (count > STREAM_BUFFER_FRAMES - index)
+            count = STREAM_BUFFER_FRAMES - index;
+        if (count > STREAM_READ_FRAMES)
+            count = STREAM_READ_FRAMES;
 
-            sounds[soundID].stopped = true;
-            sounds[soundID].next = NO_NEXT;
-            sounds[availableTail].next = soundID;
-            availableTail = soundID;
+        if (count == 0)
+            break;
+
+        int16_t *out = stream->buffer + index * 2;
+
+        if (stream->channelCount == 1) {
+            count = fread(mono, sizeof(int16_t), count, stream->file);
+            for (size_t i = 0; i < count; ++i)
+                out[i * 2 + 0] = out[i * 2 + 1] = mono[i];
         } else {
-            sounds[soundID].pos   = sound.pos;
-            sounds[soundID].times = sound.times;
+            count = fread(out, sizeof(int16_t) * 2, count, stream->file);
+        }
+
+        /* NOTE: a short read means the file got cut, it is played up to there */
+        if (count == 0) {
+            atomic_store_explicit(&stream->ended, true, memory_order_release);
+            break;
         }
+
+        stream->filePos += count;
+        write += (unsigned)count;
+        atomic_store_explicit(&stream->writeFrame, write, memory_order_release);
     }
 }
 
 
-void emptySounds(void)
+static void closeStream(Stream *stream)
 {
-    availableHead = 0;
-    availableTail = MAX_SOUND_COUNT - 1;
+    if (stream->file)
+        fclose(stream->file);
+    stream->file = NULL;
+
+    atomic_store_explicit(&stream->state, StreamFree, memory_order_release);
+}
+
 
-    for (int i = 0; i < MAX_SOUND_COUNT; ++i) {
-        sounds[i].next = i + 1;
-        sounds[i].stopped = true;
+static int startStreams(void *param)
+{
+    (void)param;
+
+    while (atomic_load(&streamsRunning)) {
+        for (int i = 0; i < MAX_STREAM_COUNT; ++i) {
+            switch (atomic_load_explicit(&streams[i].state, memory_order_acquire)) {
+                case StreamPlaying:
+                    fillStream(streams + i);
+                    break;
+                case StreamDone:
+                    closeStream(streams + i);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        /* NOTE: a read takes well under a period, a few ms keep the rings topped up */
+        thrd_sleep(&(struct timespec) { .tv_nsec = 5000000 }, NULL);
     }
 
-    sounds[MAX_SOUND_COUNT - 1].next = NO_NEXT;
+    return 0;
 }
 
 
-void initAudio(void)
+void audioReportLatency(unsigned frames)
 {
-    AudioInfo info = {
-        .writeCallback = audioCallback,
+    atomic_store_explicit(&outputLatencyFrames, frames, memory_order_relaxed);
+}
+
+
+void audioReportXrun(void)
+{
+    atomic_fetch_add_explicit(&xrunCount, 1, memory_order_relaxed);
+}
+
+
+/* NOTE: fields are read one by one, they may come from neighbouring periods */
+AudioStats audioGetStats(void)
+{
+    return (AudioStats) {
+        .mixTime         = atomic_load_explicit(&mixTime, memory_order_relaxed) * 1e-9f,
+        .mixTimeMax      = atomic_exchange_explicit(&mixTimeMax, 0, memory_order_relaxed) * 1e-9f,
+        .periodTime      = (float)atomic_load_explicit(&periodFrames, memory_order_relaxed) / AUDIO_SAMPLES_PER_SECOND,
+        .voiceCount      = atomic_load_explicit(&statVoiceCount, memory_order_relaxed),
+        .mixedVoiceCount = atomic_load_explicit(&statMixedVoiceCount, memory_order_relaxed),
+        .peakL           = atomic_load_explicit(&peakL, memory_order_relaxed) / 32768.0f,
+        .peakR           = atomic_load_explicit(&peakR, memory_order_relaxed) / 32768.0f,
+        .outputLatency   = (float)atomic_load_explicit(&outputLatencyFrames, memory_order_relaxed) / AUDIO_SAMPLES_PER_SECOND,
+        .xrunCount       = atomic_load_explicit(&xrunCount, memory_order_relaxed),
+        .streamUnderruns = atomic_load_explicit(&streamUnderruns, memory_order_relaxed),
     };
+}
+
+
+void initAudio(AudioInfo info)
+{
+    info.writeCallback = audioCallback;
 
     emptySounds();
+    initADPCM();
+
+    for (int i = 0; i < MAX_STREAM_COUNT; ++i)
+        atomic_store(&streams[i].state, StreamFree);
+    atomic_store(&streamUnderruns, 0);
+    atomic_store(&outputLatencyFrames, 0);
+    atomic_store(&xrunCount, 0);
+    atomic_store(&mixTime, 0);
+    atomic_store(&mixTimeMax, 0);
+    atomic_store(&mixedFrames, 0);
+    atomic_store(&streamsRunning, true);
+
+    clockSet = false;
+
+    if (thrd_create(&streamThread, startStreams, NULL) != thrd_success) {
+        fprintf(stderr, "failed to create the audio stream thread!\n");
+        exit(666);
+    }
 
     initAudioEngine(info);
 }
@@ -121,112 +957,417 @@ void initAudio(void)
 void exitAudio(void)
 {
     exitAudioEngine();
+
+    atomic_store(&streamsRunning, false);
+    thrd_join(streamThread, NULL);
+
+    for (int i = 0; i < MAX_STREAM_COUNT; ++i)
+        closeStream(streams + i);
 }
 
 
-int16_t *loadWAV(const char *path, uint64_t *length)
+/* NOTE: kernel half width in zero crossings of the output rate and table steps per crossing */
+#define RESAMPLE_ZERO_CROSSINGS 16
+#define RESAMPLE_RESOLUTION     512
+#define RESAMPLE_KAISER_BETA    8.0f
+
+#define WAV_FORMAT_PCM        0x0001
+#define WAV_FORMAT_FLOAT      0x0003
+#define WAV_FORMAT_EXTENSIBLE 0xfffe
+
+typedef struct
 {
-    char buffer[4];
-    uint16_t typeOfFormat, channelCount, frameSize, bitsPerSample;
-    uint32_t sampleRate, dataSize;
-    FILE *file;
+    uint16_t format;
+    uint16_t channelCount;
+    uint32_t sampleRate;
+    uint16_t frameSize;
+    uint16_t bitsPerSample;
+} WAVFormat;
 
-    if (!(file = fopen(path, "rb"))) {
-        fprintf(stderr, "Can't find file \"%s\"\n", path);
-        exit(666);
+
+static void wavError(const char *path, const char *reason)
+{
+    fprintf(stderr, "Can't parse file \"%s\". %s.\n", path, reason);
+    exit(666);
+}
+
+
+static uint16_t readU16(const uint8_t *data)
+{
+    return (uint16_t)(data[0] | data[1] << 8);
+}
+
+
+static uint32_t readU32(const uint8_t *data)
+{
+    return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+
+/* in the int16 range, whatever the source format */
+static float decodeSample(const uint8_t *data, const WAVFormat *format)
+{
+    switch (format->bitsPerSample) {
+        case 8:
+            return (data[0] - 128) * 256.0f;
+        case 16:
+            return (int16_t)readU16(data);
+        case 24:
+            return (int32_t)((uint32_t)data[0] << 8 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 24) / 65536.0f;
+        case 32:
+            if (format->format == WAV_FORMAT_FLOAT) {
+                uint32_t bits = readU32(data);
+                float sample;
+                memcpy(&sample, &bits, sizeof(float));
+                return sample * 32768.0f;
+            }
+            return (int32_t)readU32(data) / 65536.0f;
+        default:
+            unreachable();
     }
+}
 
-    // FIXME: add a file length check
 
-    safe_read(buffer, 1, 4, file);
-    if (strncmp(buffer, "RIFF", 4)) {
-        fprintf(stderr, "Can't parse file \"%s\". Wrong format.\n", path);
-        fprintf(stderr, "here\n");
-        exit(666);
+/* NOTE: mono is spread to both channels, past stereo only front left and right are kept */
+static float *decodeStereo(const uint8_t *data, size_t frameCount, const WAVFormat *format)
+{
+    float *frames = malloc(sizeof(float) * 2 * frameCount);
+    malloc_check(frames);
+
+    size_t sampleSize = format->bitsPerSample / 8;
+
+    for (size_t i = 0; i < frameCount; ++i) {
+        const uint8_t *frame = data + i * format->frameSize;
+
+        frames[i * 2 + 0] = decodeSample(frame, format);
+        frames[i * 2 + 1] = format->channelCount > 1 ? decodeSample(frame + sampleSize, format)
+                                                     : frames[i * 2 + 0];
     }
 
-    fseek(file, 4, SEEK_CUR);
-    safe_read(buffer, 1, 4, file);
-    if (strncmp(buffer, "WAVE", 4)) {
-        fprintf(stderr, "Can't parse file \"%s\". Wrong format.\n", path);
-        fprintf(stderr, "there\n");
-        exit(666);
+    return frames;
+}
+
+
+static float besselI0(float x)
+{
+    float sum = 1.0f, term = 1.0f;
+
+    for (int k = 1; k < 32; ++k) {
+        term *= (x * 0.5f / k) * (x * 0.5f / k);
+        sum  += term;
     }
 
-    fseek(file, 4, SEEK_CUR);
+    return sum;
+}
+
+
+/* one side of a Kaiser windowed sinc, sampled RESAMPLE_RESOLUTION times per zero crossing */
+static float resampleTable[RESAMPLE_ZERO_CROSSINGS * RESAMPLE_RESOLUTION + 2];
+
+
+static void buildResampleTable(void)
+{
+    float *kernel = resampleTable;
+
+    float norm = besselI0(RESAMPLE_KAISER_BETA);
+
+    for (int i = 0; i < RESAMPLE_ZERO_CROSSINGS * RESAMPLE_RESOLUTION; ++i) {
+        float x = (float)i / RESAMPLE_RESOLUTION;
+        float r = x / RESAMPLE_ZERO_CROSSINGS;
+        float sinc = i == 0 ? 1.0f : sinf(M_PI * x) / (M_PI * x);
+
+        kernel[i] = sinc * besselI0(RESAMPLE_KAISER_BETA * sqrtf(1.0f - r * r)) / norm;
+    }
+
+    /* NOTE: zero padded so the interpolation can read one past the end */
+    kernel[RESAMPLE_ZERO_CROSSINGS * RESAMPLE_RESOLUTION]     = 0.0f;
+    kernel[RESAMPLE_ZERO_CROSSINGS * RESAMPLE_RESOLUTION + 1] = 0.0f;
+}
+
+
+/* NOTE: WAVs may be loaded from several threads at once */
+static const float *resampleKernel(void)
+{
+    static once_flag once = ONCE_FLAG_INIT;
+    call_once(&once, buildResampleTable);
+
+    return resampleTable;
+}
+
+
+/* band limited to the lower of the two rates so downsampling doesn't alias */
+static float *resampleStereo(const float *in, size_t inFrames, uint32_t inRate, size_t *outFrames)
+{
+    const float *kernel = resampleKernel();
+
+    double step   = (double)inRate / AUDIO_SAMPLES_PER_SECOND;
+    float  cutoff = step > 1.0 ? (float)(1.0 / step) : 1.0f;
+    float  width  = RESAMPLE_ZERO_CROSSINGS / cutoff;
+
+    *outFrames = (size_t)ceil(inFrames / step);
 
-    int32_t lof;
-    safe_read(&lof, 1, 4, file);
+    float *out = malloc(sizeof(float) * 2 * *outFrames);
+    malloc_check(out);
 
-    safe_read(&typeOfFormat, 1, 2, file);
-    safe_read(&channelCount, 1, 2, file);
-    safe_read(&sampleRate, 1, 4, file);
-    fseek(file, 4, SEEK_CUR);
-    safe_read(&frameSize, 1, 2, file);
-    safe_read(&bitsPerSample, 1, 2, file);
+    for (size_t n = 0; n < *outFrames; ++n) {
+        double t = n * step;
 
-    // NOTE: not sure why it can have some extra garbage in it
-    // FIXME: just horrible, but add a file size check
-    char state = ' ';
-    while (state != 'f') {
-        char c;
-        safe_read(&c, 1, 1, file);
-        switch (c) {
-            case 'd':
-                state = 'd';
+        long first = (long)ceil(t - width);
+        long last  = (long)floor(t + width);
+        if (first < 0)
+            first = 0;
+        if (last > (long)inFrames - 1)
+            last = (long)inFrames - 1;
+
+        float left = 0.0f, right = 0.0f;
+
+        for (long k = first; k <= last; ++k) {
+            float position = fabsf((float)(t - k)) * cutoff * RESAMPLE_RESOLUTION;
+            int   index    = (int)position;
+
+            if (index >= RESAMPLE_ZERO_CROSSINGS * RESAMPLE_RESOLUTION)
                 continue;
-            case 'a':
-                if (state == 't') {
-                    state = 'f';
-                    continue;
-                }
-                if (state == 'd') {
-                    state = 'a';
-                    continue;
-                }
-                break;
-            case 't':
-                if (state == 'a') {
-                    state = 't';
-                    continue;
-                }
-                break;
-            default:
-                break;
+
+            float fraction = position - index;
+            float weight   = kernel[index] + (kernel[index + 1] - kernel[index]) * fraction;
+
+            left  += in[k * 2 + 0] * weight;
+            right += in[k * 2 + 1] * weight;
         }
 
-        state = ' ';
-    }
-
-    safe_read(&dataSize, 1, 4, file);
-    
-#if 0
-    printf("WAV file: %s\n"
-           "    PCM: %d\n"
-           "    Channels: %d\n"
-           "    Sample Rate: %d\n"
-           "    Frame Size: %d\n"
-           "    Bits per Sample: %d\n"
-           "    Data Size: %d\n",
-           path,
-           typeOfFormat,
-           channelCount,
-           sampleRate,
-           frameSize,
-           bitsPerSample,
-           dataSize);
-#endif
+        out[n * 2 + 0] = left  * cutoff;
+        out[n * 2 + 1] = right * cutoff;
+    }
 
-    int16_t *data = malloc(dataSize);
-    if (!data) {
-        fprintf(stderr, "failed to allocate memory for audio data \"%s\"\n", path);
-        exit(666);
+    return out;
+}
+
+
+/* NOTE: `fmt` holds at least the first 16 bytes of the chunk, 26 for extensible ones */
+static void parseWAVFormat(const char *path, const uint8_t *fmt, uint32_t chunkSize, WAVFormat *format)
+{
+    if (chunkSize < 16)
+        wavError(path, "Format chunk too short");
+
+    *format = (WAVFormat) {
+        .format        = readU16(fmt + 0),
+        .channelCount  = readU16(fmt + 2),
+        .sampleRate    = readU32(fmt + 4),
+        .frameSize     = readU16(fmt + 12),
+        .bitsPerSample = readU16(fmt + 14),
+    };
+
+    /* NOTE: the actual format is the first two bytes of the sub format GUID */
+    if (format->format == WAV_FORMAT_EXTENSIBLE && chunkSize >= 26)
+        format->format = readU16(fmt + 24);
+}
+
+
+static void checkWAVFormat(const char *path, const WAVFormat *format)
+{
+    bool pcm   = format->format == WAV_FORMAT_PCM
+              && (format->bitsPerSample == 8 || format->bitsPerSample == 16
+               || format->bitsPerSample == 24 || format->bitsPerSample == 32);
+    bool ieee  = format->format == WAV_FORMAT_FLOAT && format->bitsPerSample == 32;
+
+    if (!pcm && !ieee)
+        wavError(path, "Only integer PCM and 32 bit float are supported");
+    if (format->channelCount == 0 || format->sampleRate == 0
+     || format->frameSize < format->channelCount * (format->bitsPerSample / 8))
+        wavError(path, "Broken format chunk");
+}
+
+
+/* NOTE: walks the chunks of a whole file in memory, returns the samples */
+static const uint8_t *parseWAV(const char *path, const uint8_t *bytes, size_t size,
+                               WAVFormat *format, uint32_t *dataSize)
+{
+    if (size < 12)
+        wavError(path, "Too short");
+    if (memcmp(bytes, "RIFF", 4) || memcmp(bytes + 8, "WAVE", 4))
+        wavError(path, "Wrong format");
+
+    bool hasFormat = false;
+    const uint8_t *data = NULL;
+
+    size_t offset = 12;
+    while (offset + 8 <= size && !data) {
+        const uint8_t *chunk = bytes + offset;
+        offset += 8;
+
+        uint32_t chunkSize = readU32(chunk + 4);
+        if (chunkSize > size - offset)
+            wavError(path, "Chunk past the end of the file");
+
+        if (!memcmp(chunk, "fmt ", 4)) {
+            parseWAVFormat(path, bytes + offset, chunkSize, format);
+            hasFormat = true;
+        } else if (!memcmp(chunk, "data", 4)) {
+            data      = bytes + offset;
+            *dataSize = chunkSize;
+        }
+
+        /* chunks are word aligned */
+        offset += chunkSize + (chunkSize & 1);
     }
 
-    safe_read(data, 1, dataSize, file);
-    *length = dataSize / (bitsPerSample / 8);
+    if (!hasFormat)
+        wavError(path, "No format chunk");
+    if (!data)
+        wavError(path, "No data chunk");
 
-    fclose(file);
+    checkWAVFormat(path, format);
 
     return data;
 }
+
+
+/* NOTE: streams can't have the whole file in memory, leaves `file` at the start of the samples */
+static FILE *openWAV(const char *path, WAVFormat *format, uint32_t *dataSize)
+{
+    FILE *file = fopen(path, "rb");
+    file_check(file, path);
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t header[12];
+    if (fileSize < 12)
+        wavError(path, "Too short");
+    safe_read(header, 1, 12, file);
+
+    if (memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4))
+        wavError(path, "Wrong format");
+
+    bool hasFormat = false;
+    long dataOffset = -1;
+
+    /* walks the chunks, skipping the ones we don't care about */
+    long offset = 12;
+    while (offset + 8 <= fileSize && dataOffset < 0) {
+        uint8_t chunk[8];
+        safe_read(chunk, 1, 8, file);
+        offset += 8;
+
+        uint32_t chunkSize = readU32(chunk + 4);
+        if (chunkSize > (uint32_t)(fileSize - offset))
+            wavError(path, "Chunk past the end of the file");
+
+        if (!memcmp(chunk, "fmt ", 4)) {
+            uint8_t fmt[40] = { 0 };
+            size_t fmtSize = chunkSize < sizeof(fmt) ? chunkSize : sizeof(fmt);
+            safe_read(fmt, 1, fmtSize, file);
+
+            parseWAVFormat(path, fmt, chunkSize, format);
+            hasFormat = true;
+        } else if (!memcmp(chunk, "data", 4)) {
+            dataOffset = offset;
+            *dataSize  = chunkSize;
+        }
+
+        /* chunks are word aligned */
+        offset += chunkSize + (chunkSize & 1);
+        fseek(file, offset, SEEK_SET);
+    }
+
+    if (!hasFormat)
+        wavError(path, "No format chunk");
+    if (dataOffset < 0)
+        wavError(path, "No data chunk");
+
+    checkWAVFormat(path, format);
+
+    fseek(file, dataOffset, SEEK_SET);
+
+    return file;
+}
+
+
+/* NOTE: everything is converted once here to the mixer's 16 bit stereo at
+ *       AUDIO_SAMPLES_PER_SECOND, `length` is in samples */
+int16_t *loadWAV(const char *path, uint64_t *length)
+{
+    Asset asset = assetLoad(path);
+
+    WAVFormat format;
+    uint32_t dataSize;
+    const uint8_t *data = parseWAV(path, asset.data, asset.size, &format, &dataSize);
+
+    size_t frameCount = dataSize / format.frameSize;
+
+    /* already in the mixer's format, only copied out of the asset */
+    if (format.format == WAV_FORMAT_PCM && format.bitsPerSample == 16 && format.channelCount == 2
+     && format.sampleRate == AUDIO_SAMPLES_PER_SECOND) {
+        int16_t *samples = malloc(frameCount ? frameCount * 4 : 1);
+        malloc_check(samples);
+        memcpy(samples, data, frameCount * 4);
+        assetFree(asset);
+
+        *length = frameCount * 2;
+        return samples;
+    }
+
+    float *frames = decodeStereo(data, frameCount, &format);
+    assetFree(asset);
+
+    if (format.sampleRate != AUDIO_SAMPLES_PER_SECOND) {
+        float *resampled = resampleStereo(frames, frameCount, format.sampleRate, &frameCount);
+        free(frames);
+        frames = resampled;
+    }
+
+    int16_t *samples = malloc(sizeof(int16_t) * 2 * (frameCount ? frameCount : 1));
+    malloc_check(samples);
+    writeMixBus(samples, frames, frameCount * 2, 1.0f);
+    free(frames);
+
+    *length = frameCount * 2;
+
+    return samples;
+}
+
+
+SoundHandle playStream(const char *path, Sound sound)
+{
+    int index = 0;
+    while (index < MAX_STREAM_COUNT
+        && atomic_load_explicit(&streams[index].state, memory_order_acquire) != StreamFree)
+        ++index;
+
+    if (index == MAX_STREAM_COUNT)
+        return NO_SOUND;
+
+    WAVFormat format;
+    uint32_t dataSize;
+    FILE *file = openWAV(path, &format, &dataSize);
+
+    if (format.format != WAV_FORMAT_PCM || format.bitsPerSample != 16 || format.channelCount > 2
+     || format.frameSize != format.channelCount * 2 || format.sampleRate != AUDIO_SAMPLES_PER_SECOND)
+        wavError(path, "Streams have to be 16 bit mono or stereo at the mixer rate");
+
+    Stream *stream = streams + index;
+
+    stream->file         = file;
+    stream->dataOffset   = ftell(file);
+    stream->frameCount   = dataSize / format.frameSize;
+    stream->filePos      = 0;
+    stream->times        = sound.times;
+    stream->channelCount = format.channelCount;
+
+    atomic_store(&stream->writeFrame, 0);
+    atomic_store(&stream->readFrame, 0);
+    atomic_store(&stream->ended, false);
+
+    /* NOTE: prefilled here so it doesn't start out starved, the I/O thread
+     *       doesn't look at it until it's playing */
+    fillStream(stream);
+
+    atomic_store_explicit(&stream->state, StreamPlaying, memory_order_release);
+
+    SoundHandle handle = pushSound(sound, index);
+    if (handle == NO_SOUND)
+        releaseStream(index);
+
+    return handle;
+}
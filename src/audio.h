@@ -10,38 +10,174 @@
 
 typedef void (*AudioWriteCallback)(int16_t *buffer, unsigned size);
 
+typedef enum
+{
+    /* mixes a period every period length, like a device would pull it */
+    AudioNullRealTime,
+    /* mixes back to back on the audio thread */
+    AudioNullMaxRate,
+    /* no thread, periods are mixed by audioNullRender */
+    AudioNullManual,
+
+    AudioNullModeCount
+} AudioNullMode;
+
 typedef struct
 {
+    /* filled in by initAudio */
     AudioWriteCallback writeCallback;
+
+    /* in frames, 0 picks the backend default */
+    unsigned periodSize;
+
+    /* NOTE: a few ms of buffering instead of ~100, through mmap access and
+     *       poll wakeups on ALSA */
+    bool lowLatency;
+    /* asks for real-time scheduling of the audio thread, keeps going without it */
+    bool realTime;
+
+    /* null backend only, see audio_null.c */
+    AudioNullMode nullMode;
+    const char *nullWAVPath;
 } AudioInfo;
 
+/* NOTE: overridable for benchmarks */
+#ifndef MAX_SOUND_COUNT
 #define MAX_SOUND_COUNT 32
+#endif
 #define TIMES_INF       0xffffffff
 
+/* NOTE: voices past MAX_SOUND_COUNT are virtual, they keep their place in the
+ *       sound but aren't mixed until they are among the most important again */
+#ifndef MAX_VOICE_COUNT
+#define MAX_VOICE_COUNT (MAX_SOUND_COUNT * 4)
+#endif
+
+/* positional gains below it are treated as silence and the voice goes virtual */
+#define SOUND_AUDIBLE_GAIN 0.001f
+/* distance up to which positional sounds play at full volume */
+#define SOUND_REF_DISTANCE 2.0f
+
+/* NOTE: power of two, commands past it are dropped until the mixer catches up */
+#ifndef SOUND_COMMAND_COUNT
+#define SOUND_COMMAND_COUNT 256
+#endif
+
+/* in samples, the float mix bus is processed a chunk at a time */
+#define MIX_CHUNK_SIZE 512
+
+/* NOTE: IMA ADPCM blocks, a 4 byte predictor and step index header per channel
+ *       followed by a byte per frame with the left code in the low nibble */
+#define ADPCM_BLOCK_FRAMES 128
+#define ADPCM_BLOCK_SIZE   (8 + ADPCM_BLOCK_FRAMES)
+
+/* NOTE: streamed sounds are read from disk by an I/O thread while they play,
+ *       each through a ring of STREAM_BUFFER_FRAMES, a power of two */
+#define MAX_STREAM_COUNT     4
+#define STREAM_BUFFER_FRAMES 32768
+#define STREAM_READ_FRAMES   (AUDIO_SAMPLES_PER_SECOND / 20)
+
+/* NOTE: scheduled sounds start a period plus this many frames after their time,
+ *       so that ones from the last game step are still ahead of the mixer */
+#define SOUND_SCHEDULE_MARGIN (AUDIO_SAMPLES_PER_SECOND / 60)
+/* in frames, the clock is set anew when the game drifts further than this from
+ * the mixer, like after a pause, smaller drift is eased out */
+#define AUDIO_CLOCK_TOLERANCE (AUDIO_SAMPLES_PER_SECOND / 20)
+
+typedef enum
+{
+    SoundPriorityLow,
+    SoundPriorityNormal,
+    SoundPriorityHigh,
+
+    SoundPriorityCount
+} SoundPriority;
+
 typedef struct
 {
     int16_t *data;
+    /* NOTE: decoded while mixing instead of `data` when set, positions stay in samples */
+    const uint8_t *blocks;
     unsigned times;
     size_t start, end, pos;
     float volL, volR;
 
-    /* null initialized */
-    union {
-        int next;
-        void *volatile *handle;
-    };
-    unsigned stopped;   /* true/false */
+    /* NOTE: positional sounds are attenuated and panned against the listener,
+     *       silent past `radius` and volL/volR only scale them */
+    bool positional;
+    float x, y, z;
+    float radius;
+
+    /* decides which voices get stolen or go virtual first */
+    SoundPriority priority;
+
+    /* NOTE: in game time as given to setAudioClock, the sound starts on that
+     *       exact frame instead of the next period, 0 plays it right away */
+    double time;
 } Sound;
 
+/* NOTE: 0 is never handed out, handles of finished sounds are simply ignored */
+typedef uint32_t SoundHandle;
+#define NO_SOUND 0
+
 
 void initAudioEngine(AudioInfo info);
 void exitAudioEngine(void);
 
-void initAudio(void);
+void initAudio(AudioInfo info);
 void exitAudio(void);
 
-bool playSound(Sound info);
+/* NOTE: published by the audio thread as it goes, times in seconds */
+typedef struct
+{
+    /* of the last audioCallback, the worst one since the last audioGetStats and its budget */
+    float mixTime, mixTimeMax;
+    float periodTime;
+
+    int voiceCount, mixedVoiceCount;
+
+    /* of the last period, relative to full scale, past 1 clips */
+    float peakL, peakR;
+
+    /* between a frame being mixed and it being played, as last measured */
+    float outputLatency;
+
+    /* since initAudio, times the device ran dry and callbacks in which a stream did */
+    unsigned xrunCount;
+    unsigned streamUnderruns;
+} AudioStats;
+
+/* NOTE: called by the backends from the audio thread */
+void audioReportLatency(unsigned frames);
+void audioReportXrun(void);
+
+AudioStats audioGetStats(void);
+
+/* null backend only, prints the mix times of the periods since the last report
+ * and returns their average in seconds */
+void audioNullRender(unsigned periodCount);
+double audioNullReport(const char *label);
+
+/* NOTE: these only queue a command for the mixer and must all be called from one thread */
+SoundHandle playSound(Sound sound);
+bool stopSound(SoundHandle handle);
+bool setSoundVolume(SoundHandle handle, float volL, float volR);
+bool setSoundPosition(SoundHandle handle, float x, float y, float z);
+/* `yaw` as in camState */
+bool setSoundListener(float x, float y, float z, float yaw);
+
+/* NOTE: ties game time to the mixer's frames for Sound.time, call it once every
+ *       game step with the time of that step, from the same thread */
+void setAudioClock(double time);
+
+/* NOTE: the file has to be 16 bit mono or stereo at AUDIO_SAMPLES_PER_SECOND,
+ *       `sound` only gives the playback settings, its data and range are ignored */
+SoundHandle playStream(const char *path, Sound sound);
+
+void audioCallback(int16_t *buffer, unsigned size);
 
 int16_t *loadWAV(const char *path, uint64_t *length);
+/* NOTE: `length` in samples as loadWAV gives it, about a fourth of the size */
+uint8_t *encodeADPCM(const int16_t *samples, uint64_t length);
 
 #endif
@@ -0,0 +1,202 @@
+#include "audio.h"
+
+#include "state.h"
+#include "utils.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <threads.h>
+
+#if MAX_SOUND_COUNT < 512
+#error "audio_bench needs -DMAX_SOUND_COUNT=512, see compile/audio_bench"
+#endif
+
+#define BENCH_PERIOD_FRAMES 480
+#define BENCH_PERIODS       2000
+#define BENCH_DATA_FRAMES   AUDIO_SAMPLES_PER_SECOND
+
+/* NOTE: longer than a stream's ring, played twice to go through the loop back */
+#define STREAM_BENCH_PATH  "res/bite87.wav"
+#define STREAM_BENCH_TIMES 2
+
+AppState appState;
+
+static int16_t data[BENCH_DATA_FRAMES * 2];
+static uint8_t *blocks;
+
+
+/* NOTE: returns the average mix time of a period */
+static double bench(int voiceCount, bool adpcm)
+{
+    SoundHandle handles[MAX_SOUND_COUNT];
+
+    for (int i = 0; i < voiceCount; ++i) {
+        size_t offset = (size_t)(rand() % BENCH_DATA_FRAMES) * 2;
+        handles[i] = playSound((Sound) {
+            .data   = adpcm ? NULL : data,
+            .blocks = adpcm ? blocks : NULL,
+            .start = 0,
+            .pos   = offset,
+            .end   = BENCH_DATA_FRAMES * 2,
+            .volL  = 0.5f + 0.5f * rand() / RAND_MAX,
+            .volR  = 0.5f + 0.5f * rand() / RAND_MAX,
+            .times = TIMES_INF,
+        });
+    }
+
+    /* picks the commands up */
+    audioNullRender(1);
+    audioNullReport(NULL);
+
+    char label[64];
+    snprintf(label, sizeof(label), "%d voices %s", voiceCount, adpcm ? "adpcm" : "pcm");
+
+    audioNullRender(BENCH_PERIODS);
+    double average = audioNullReport(label);
+
+    for (int i = 0; i < voiceCount; ++i)
+        stopSound(handles[i]);
+    audioNullRender(1);
+    audioNullReport(NULL);
+
+    return average;
+}
+
+
+static void sleepUntil(double deadline)
+{
+    double left = deadline - monotonicSeconds();
+    if (left > 0.0)
+        thrd_sleep(&(struct timespec) { (time_t)left, (long)((left - (time_t)left) * 1e9) }, NULL);
+}
+
+
+/* NOTE: the stream plays against an inverted copy of the file loaded whole, so
+ *       anything it drops or garbles shows up as a peak past a step of the
+ *       saturated -32768, false when it does.
+ *       Periods are mixed in real time for the I/O thread to keep up */
+static bool benchStream(void)
+{
+    uint64_t length;
+    int16_t *samples = loadWAV(STREAM_BENCH_PATH, &length);
+
+    /* NOTE: inverted in the data, voices with negative volumes count as inaudible */
+    for (uint64_t i = 0; i < length; ++i)
+        samples[i] = samples[i] == INT16_MIN ? INT16_MAX : -samples[i];
+
+    unsigned underruns = audioGetStats().streamUnderruns;
+
+    playSound((Sound) {
+        .data  = samples,
+        .end   = length,
+        .volL  = 1.0f,
+        .volR  = 1.0f,
+        .times = STREAM_BENCH_TIMES,
+    });
+    SoundHandle handle = playStream(STREAM_BENCH_PATH, (Sound) {
+        .volL  = 1.0f,
+        .volR  = 1.0f,
+        .times = STREAM_BENCH_TIMES,
+    });
+
+    bool passed = handle != NO_SOUND;
+
+    /* NOTE: a period more to let both of them finish */
+    unsigned periodCount = (unsigned)(length / 2 * STREAM_BENCH_TIMES / BENCH_PERIOD_FRAMES) + 2;
+    double period = (double)BENCH_PERIOD_FRAMES / AUDIO_SAMPLES_PER_SECOND;
+    double deadline = monotonicSeconds();
+    float peak = 0.0f;
+
+    for (unsigned i = 0; i < periodCount; ++i) {
+        audioNullRender(1);
+
+        AudioStats stats = audioGetStats();
+        peak = fmaxf(peak, fmaxf(stats.peakL, stats.peakR));
+
+        deadline += period;
+        sleepUntil(deadline);
+    }
+
+    audioNullReport("stream");
+
+    AudioStats stats = audioGetStats();
+    underruns = stats.streamUnderruns - underruns;
+
+    printf("stream %s: peak against the loaded copy %g, %u underruns, %d voices left\n",
+            STREAM_BENCH_PATH, peak, underruns, stats.voiceCount);
+
+    passed = passed && peak <= 1.0f / 32768.0f && underruns == 0 && stats.voiceCount == 0;
+
+    /* NOTE: stopped streams have to hand their slots back once the I/O thread closes them */
+    for (int round = 0; round < 2; ++round) {
+        SoundHandle handles[MAX_STREAM_COUNT];
+
+        for (int i = 0; i < MAX_STREAM_COUNT; ++i) {
+            handles[i] = playStream(STREAM_BENCH_PATH, (Sound) { .volL = 1.0f, .volR = 1.0f, .times = TIMES_INF });
+            if (handles[i] == NO_SOUND) {
+                printf("stream slot %d still taken after stopping, round %d\n", i, round);
+                passed = false;
+            }
+        }
+
+        audioNullRender(4);
+
+        for (int i = 0; i < MAX_STREAM_COUNT; ++i)
+            stopSound(handles[i]);
+
+        audioNullRender(1);
+        audioNullReport(NULL);
+
+        /* a few of the I/O thread's rounds */
+        sleepUntil(monotonicSeconds() + 0.05);
+    }
+
+    free(samples);
+
+    return passed;
+}
+
+
+/* NOTE: the mix is written to argv[1] when given, run from the game directory for the stream */
+int main(int argc, char *argv[])
+{
+    srand(666);
+    appState.volume = 1.0f;
+
+    for (int i = 0; i < BENCH_DATA_FRAMES; ++i) {
+        float t = (float)i / AUDIO_SAMPLES_PER_SECOND;
+        data[i * 2 + 0] = (int16_t)(8000.0f * sinf(6.2831853f * 440.0f * t));
+        data[i * 2 + 1] = (int16_t)(8000.0f * sinf(6.2831853f * 660.0f * t));
+    }
+
+    initAudio((AudioInfo) {
+        .periodSize  = BENCH_PERIOD_FRAMES,
+        .nullMode    = AudioNullManual,
+        .nullWAVPath = argc > 1 ? argv[1] : NULL,
+    });
+
+    blocks = encodeADPCM(data, BENCH_DATA_FRAMES * 2);
+
+    int voiceCounts[] = { 32, 128, 512 };
+
+    for (size_t i = 0; i < sizeof(voiceCounts) / sizeof(*voiceCounts); ++i) {
+        double pcm   = bench(voiceCounts[i], false);
+        double adpcm = bench(voiceCounts[i], true);
+
+        printf("adpcm decode: %.3f us per voice per period\n",
+                (adpcm - pcm) * 1e6 / voiceCounts[i]);
+    }
+
+    bool streamPassed = benchStream();
+
+    exitAudio();
+    free(blocks);
+
+    if (!streamPassed) {
+        fprintf(stderr, "streamed playback doesn't match the file!\n");
+        return 1;
+    }
+
+    return 0;
+}
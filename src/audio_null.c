@@ -0,0 +1,204 @@
+#include "audio.h"
+
+#include "utils.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+/* Device-less backend for measuring the mixer. Periods are mixed in real time,
+ * as fast as possible or on demand, optionally written out to a WAV file, and
+ * the time each audioCallback takes is reported on exit. */
+
+#define CHANNEL_COUNT 2
+#define DEFAULT_PERIOD_SIZE (AUDIO_SAMPLES_PER_SECOND / 40)
+
+static thrd_t thread;
+static volatile int running = 1;
+
+/* global so the thread doesn't outlive it */
+static AudioInfo audioInfo;
+
+static int16_t *writeBuffer;
+static FILE *wavFile;
+static uint32_t wavDataSize;
+
+static double *periodTimes;
+static size_t periodCount;
+static size_t periodCapacity;
+
+
+static void writeWAVHeader(FILE *file, uint32_t dataSize)
+{
+    uint16_t format = 1, channels = CHANNEL_COUNT, frameSize = CHANNEL_COUNT * 2, bits = 16;
+    uint32_t rate = AUDIO_SAMPLES_PER_SECOND, byteRate = rate * frameSize;
+    uint32_t fmtSize = 16, riffSize = 36 + dataSize;
+
+    safe_write("RIFF", 1, 4, file);
+    safe_write(&riffSize, 4, 1, file);
+    safe_write("WAVEfmt ", 1, 8, file);
+    safe_write(&fmtSize, 4, 1, file);
+    safe_write(&format, 2, 1, file);
+    safe_write(&channels, 2, 1, file);
+    safe_write(&rate, 4, 1, file);
+    safe_write(&byteRate, 4, 1, file);
+    safe_write(&frameSize, 2, 1, file);
+    safe_write(&bits, 2, 1, file);
+    safe_write("data", 1, 4, file);
+    safe_write(&dataSize, 4, 1, file);
+}
+
+
+static void renderPeriod(void)
+{
+    double start = monotonicSeconds();
+    audioInfo.writeCallback(writeBuffer, audioInfo.periodSize);
+    double time = monotonicSeconds() - start;
+    safe_push(periodTimes, periodCount, periodCapacity, time);
+
+    /* NOTE: as a device with a single period of buffering would see it */
+    audioReportLatency(audioInfo.periodSize);
+    if (audioInfo.nullMode == AudioNullRealTime && time > (double)audioInfo.periodSize / AUDIO_SAMPLES_PER_SECOND)
+        audioReportXrun();
+
+    if (wavFile) {
+        safe_write(writeBuffer, sizeof(int16_t), audioInfo.periodSize * CHANNEL_COUNT, wavFile);
+        wavDataSize += audioInfo.periodSize * CHANNEL_COUNT * sizeof(int16_t);
+    }
+}
+
+
+static int startNull(void *param)
+{
+    (void)param;
+
+    double period = (double)audioInfo.periodSize / AUDIO_SAMPLES_PER_SECOND;
+    double deadline = monotonicSeconds();
+
+    while (running) {
+        renderPeriod();
+
+        if (audioInfo.nullMode != AudioNullRealTime)
+            continue;
+
+        /* NOTE: sleeps to an absolute deadline so mix time doesn't drift the pace */
+        deadline += period;
+        double left = deadline - monotonicSeconds();
+        if (left > 0.0) {
+            struct timespec ts = { (time_t)left, (long)((left - (time_t)left) * 1e9) };
+            thrd_sleep(&ts, NULL);
+        }
+    }
+
+    return 0;
+}
+
+
+static int compareTimes(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+
+void audioNullRender(unsigned count)
+{
+    assert(audioInfo.nullMode == AudioNullManual);
+
+    for (unsigned i = 0; i < count; ++i)
+        renderPeriod();
+}
+
+
+/* NOTE: a NULL `label` only drops the collected times */
+double audioNullReport(const char *label)
+{
+    if (periodCount == 0 || !label) {
+        periodCount = 0;
+        return 0.0;
+    }
+
+    double budget = (double)audioInfo.periodSize / AUDIO_SAMPLES_PER_SECOND;
+    double sum = 0.0;
+    size_t overruns = 0;
+    size_t count = periodCount;
+
+    for (size_t i = 0; i < periodCount; ++i) {
+        sum += periodTimes[i];
+        overruns += periodTimes[i] > budget;
+    }
+
+    qsort(periodTimes, periodCount, sizeof(double), compareTimes);
+
+    printf("%s: %zu periods of %u frames, mix time us min %.2f avg %.2f p99 %.2f max %.2f"
+           " (%.2f%% of budget on average, %zu over budget)\n",
+            label,
+            periodCount,
+            audioInfo.periodSize,
+            periodTimes[0] * 1e6,
+            sum / periodCount * 1e6,
+            periodTimes[(periodCount - 1) * 99 / 100] * 1e6,
+            periodTimes[periodCount - 1] * 1e6,
+            100.0 * sum / periodCount / budget,
+            overruns);
+
+    periodCount = 0;
+
+    return sum / count;
+}
+
+
+void initAudioEngine(AudioInfo info)
+{
+    audioInfo = info;
+    if (!audioInfo.periodSize)
+        audioInfo.periodSize = DEFAULT_PERIOD_SIZE;
+
+    writeBuffer = calloc(audioInfo.periodSize * CHANNEL_COUNT, sizeof(int16_t));
+    malloc_check(writeBuffer);
+
+    if (audioInfo.nullWAVPath) {
+        wavFile = fopen(audioInfo.nullWAVPath, "wb");
+        file_check(wavFile, audioInfo.nullWAVPath);
+
+        /* sizes are patched on exit */
+        writeWAVHeader(wavFile, 0);
+    }
+
+    if (audioInfo.nullMode == AudioNullManual)
+        return;
+
+    running = 1;
+
+    if (thrd_create(&thread, startNull, NULL) != thrd_success) {
+        fprintf(stderr, "failed to create a separate audio thread!\n");
+        exit(222);
+    }
+}
+
+
+void exitAudioEngine(void)
+{
+    if (audioInfo.nullMode != AudioNullManual) {
+        running = 0;
+        thrd_join(thread, NULL);
+    }
+
+    audioNullReport("null audio");
+
+    if (wavFile) {
+        rewind(wavFile);
+        writeWAVHeader(wavFile, wavDataSize);
+        fclose(wavFile);
+        wavFile = NULL;
+    }
+
+    free(writeBuffer);
+    free(periodTimes);
+    periodTimes = NULL;
+    periodCount = periodCapacity = 0;
+}
@@ -1,6 +1,9 @@
 #include "core.h"
 
 #include "utils.h"
+#include "pack.h"
+#include "texture.h"
+#include "program_cache.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -139,16 +142,22 @@ ModelObject createBoxModelObject(void)
 }
 
 
-int loadShader(const char *path, GLenum type)
+/* NOTE: the driver may still be compiling when this returns */
+static int compileShader(Asset source, GLenum type)
 {
-    char *source = readFile(path);
-    if (!source)
-        exit(1);
+    const char *text = (const char *)source.data;
+    int length = (int)source.size;
 
     int shader = glCreateShader(type);
-    glShaderSource(shader, 1, (const char * const*)&source, NULL);
+    glShaderSource(shader, 1, &text, &length);
     glCompileShader(shader);
 
+    return shader;
+}
+
+
+static void checkShader(int shader, const char *path)
+{
     int success;
     char infoLog[512];
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -158,46 +167,179 @@ int loadShader(const char *path, GLenum type)
                         "%s", path, infoLog);
         exit(1);
     }
+}
+
+
+int loadShader(const char *path, GLenum type)
+{
+    Asset source = assetLoad(path);
+    int shader = compileShader(source, type);
+    assetFree(source);
+
+    checkShader(shader, path);
 
-    free(source);
     return shader;
 }
 
 
+typedef struct
+{
+    const char *vertexPath;
+    const char *fragmentPath;
+    int program;
+    int vertexShader;
+    int fragmentShader;
+    uint64_t key;
+    double seconds;
+} PendingProgram;
+
+static PendingProgram pendingPrograms[MAX_PENDING_PROGRAM_COUNT];
+static int pendingProgramCount;
+
+
 int createProgram(const char *vertexPath, const char *fragmentPath)
 {
-    int vertexShader = loadShader(vertexPath, GL_VERTEX_SHADER);
-    int fragmentShader = loadShader(fragmentPath, GL_FRAGMENT_SHADER);
+    double start = monotonicSeconds();
+
+    Asset vertexSource   = assetLoad(vertexPath);
+    Asset fragmentSource = assetLoad(fragmentPath);
+
+    uint64_t key = hashBytes(HASH_SEED, vertexSource.data, vertexSource.size);
+    key = hashBytes(key, fragmentSource.data, fragmentSource.size);
+
     int program = glCreateProgram();
 
+    if (programCacheFind(key, program)) {
+        assetFree(vertexSource);
+        assetFree(fragmentSource);
+
+        programCacheTiming(vertexPath, fragmentPath, monotonicSeconds() - start, true);
+        return program;
+    }
+
+    if (pendingProgramCount == MAX_PENDING_PROGRAM_COUNT) {
+        fprintf(stderr, "%s:%d: too many programs compiling at once! path: \"%s\".\n",
+                __FILE__, __LINE__, vertexPath);
+        exit(666);
+    }
+
+    int vertexShader = compileShader(vertexSource, GL_VERTEX_SHADER);
+    int fragmentShader = compileShader(fragmentSource, GL_FRAGMENT_SHADER);
+
+    assetFree(vertexSource);
+    assetFree(fragmentSource);
+
     glAttachShader(program, vertexShader);
     glAttachShader(program, fragmentShader);
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(program);
 
+    /* NOTE: asking for the status now would wait on the driver, finishPrograms does it */
+    pendingPrograms[pendingProgramCount++] = (PendingProgram) {
+        vertexPath, fragmentPath,
+        program, vertexShader, fragmentShader,
+        key, monotonicSeconds() - start
+    };
+
+    return program;
+}
+
+
+static void checkProgram(PendingProgram *pending)
+{
+    double start = monotonicSeconds();
+
     int success;
     char infoLog[512];
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    glGetProgramiv(pending->program, GL_LINK_STATUS, &success);
     if (!success) {
-        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        checkShader(pending->vertexShader, pending->vertexPath);
+        checkShader(pending->fragmentShader, pending->fragmentPath);
+
+        glGetProgramInfoLog(pending->program, 512, NULL, infoLog);
         fprintf(stderr, "[\033[1;31mERROR\033[0m] Failed to link shader program!\n"
                         "%s", infoLog);
         exit(1);
     }
 
-    glDetachShader(program, vertexShader);
-    glDeleteShader(vertexShader);
-    glDetachShader(program, fragmentShader);
-    glDeleteShader(fragmentShader);
+    glDetachShader(pending->program, pending->vertexShader);
+    glDeleteShader(pending->vertexShader);
+    glDetachShader(pending->program, pending->fragmentShader);
+    glDeleteShader(pending->fragmentShader);
 
-    return program;
+    programCacheStore(pending->key, pending->program);
+    programCacheTiming(pending->vertexPath, pending->fragmentPath,
+                       pending->seconds + monotonicSeconds() - start, false);
+}
+
+
+static bool hasParallelShaderCompile(void)
+{
+    int extensionCount;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+
+    for (int i = 0; i < extensionCount; ++i) {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+
+        if (!strcmp(extension, "GL_KHR_parallel_shader_compile")
+         || !strcmp(extension, "GL_ARB_parallel_shader_compile"))
+            return true;
+    }
+
+    return false;
+}
+
+
+void finishPrograms(void)
+{
+    bool parallel = pendingProgramCount > 1 && hasParallelShaderCompile();
+    bool checked[MAX_PENDING_PROGRAM_COUNT] = { 0 };
+
+    for (int remaining = pendingProgramCount; remaining; ) {
+        int checkedCount = 0;
+
+        /* NOTE: without the extension every query waits, so they go in order */
+        for (int i = 0; i < pendingProgramCount && parallel; ++i) {
+            if (checked[i])
+                continue;
+
+            int completed;
+            glGetProgramiv(pendingPrograms[i].program, GL_COMPLETION_STATUS_KHR, &completed);
+            if (!completed)
+                continue;
+
+            checkProgram(pendingPrograms + i);
+            checked[i] = true;
+            ++checkedCount;
+        }
+
+        /* NOTE: nothing's done yet, wait on the first one */
+        if (!checkedCount) {
+            int first = 0;
+            while (checked[first])
+                ++first;
+
+            checkProgram(pendingPrograms + first);
+            checked[first] = true;
+            ++checkedCount;
+        }
+
+        remaining -= checkedCount;
+    }
+
+    pendingProgramCount = 0;
 }
 
 
 uint8_t *loadImage(const char *path, int *width, int *height, int *channels, bool flip)
 {
-    stbi_set_flip_vertically_on_load(flip);
+    /* NOTE: per thread, images are decoded by the loader's workers too */
+    stbi_set_flip_vertically_on_load_thread(flip);
+
+    Asset asset = assetLoad(path);
+    uint8_t *image = stbi_load_from_memory(asset.data, (int)asset.size, width, height, channels, STBI_rgb_alpha);
+    assetFree(asset);
 
-    uint8_t *image = stbi_load(path, width, height, channels, STBI_rgb_alpha);
     if (!image) {
         fprintf(stderr, "Failed to load image \"%s\"\n", path);
         exit(1);
@@ -207,24 +349,119 @@ uint8_t *loadImage(const char *path, int *width, int *height, int *channels, boo
 }
 
 
-unsigned createTexture(const char *path)
+/* NOTE: NULL when it's missing, stale or cooked for the other way up */
+static const uint8_t *cookedTextureLevels(const char *cookedPath, const char *path, bool flip,
+                                          Asset cooked, TextureHeader *header)
 {
-    int width, height, channelCount;
-    uint8_t *image = loadImage(path, &width, &height, &channelCount, true);
+    if (cooked.size < sizeof(*header))
+        return NULL;
+    memcpy(header, cooked.data, sizeof(*header));
+
+    if (memcmp(header->magic, TEXTURE_MAGIC, 4) || header->version != TEXTURE_VERSION
+     || !header->width || !header->height || header->width > 1 << 15 || header->height > 1 << 15
+     || header->levelCount != (uint32_t)textureLevelCount(header->width, header->height)
+     || cooked.size != sizeof(*header) + textureLevelsSize(header->width, header->height, header->levelCount)) {
+        fprintf(stderr, "Broken cooked texture \"%s\", cook it again\n", cookedPath);
+        return NULL;
+    }
 
-    unsigned texture;
-    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    Asset source = assetLoad(path);
+    uint64_t sourceHash = textureHash(source.data, source.size);
+    assetFree(source);
+
+    if (header->sourceHash != sourceHash || !(header->flags & TextureFlipped) != !flip) {
+        fprintf(stderr, "Stale cooked texture \"%s\", cook it again\n", cookedPath);
+        return NULL;
+    }
+
+    return cooked.data + sizeof(*header);
+}
+
+
+TextureImage loadTextureImage(const char *path, bool flip)
+{
+    char cookedPath[256];
+    Asset cooked;
+
+    if (textureCookedPath(cookedPath, sizeof(cookedPath), path) && assetTryLoad(cookedPath, &cooked)) {
+        TextureHeader header;
+        const uint8_t *levels = cookedTextureLevels(cookedPath, path, flip, cooked, &header);
+
+        if (levels) {
+            return (TextureImage) {
+                .pixels     = levels,
+                .width      = (int)header.width,
+                .height     = (int)header.height,
+                .levelCount = (int)header.levelCount,
+                .cooked     = cooked,
+            };
+        }
+
+        assetFree(cooked);
+    }
+
+    int channelCount;
+    TextureImage image = { .levelCount = 1 };
+    image.decoded = loadImage(path, &image.width, &image.height, &channelCount, flip);
+    image.pixels  = image.decoded;
+
+    return image;
+}
+
+
+void freeTextureImage(TextureImage image)
+{
+    free(image.decoded);
+    assetFree(image.cooked);
+}
+
+
+/* NOTE: uploads what `image` has of the `levelCount` levels, the rest is generated */
+static void fillTextureLevels(unsigned texture, int face, TextureImage image, int levelCount)
+{
+    const uint8_t *pixels = image.pixels;
+    int uploadCount = image.levelCount < levelCount ? image.levelCount : levelCount;
+
+    for (int level = 0; level < uploadCount; ++level) {
+        int width  = image.width  >> level ? image.width  >> level : 1;
+        int height = image.height >> level ? image.height >> level : 1;
+
+        if (face < 0)
+            glTextureSubImage2D(texture, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        else
+            glTextureSubImage3D(texture, level, 0, 0, face, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+        pixels += (size_t)width * height * 4;
+    }
+}
+
+
+void fillTexture(unsigned texture, TextureImage image)
+{
     glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
     glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    glTextureStorage2D(texture, (int)log2(width), GL_RGBA8, width, height);
-    glTextureSubImage2D(texture, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, image);
+    int levelCount = (int)log2(image.width);
+
+    glTextureStorage2D(texture, levelCount, GL_RGBA8, image.width, image.height);
+    fillTextureLevels(texture, -1, image, levelCount);
+
+    if (image.levelCount < levelCount)
+        glGenerateTextureMipmap(texture);
+}
+
+
+unsigned createTexture(const char *path)
+{
+    TextureImage image = loadTextureImage(path, true);
 
-    glGenerateTextureMipmap(texture);
+    unsigned texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    fillTexture(texture, image);
 
-    free(image);
+    freeTextureImage(image);
 
     return texture;
 }
@@ -237,8 +474,50 @@ ModelObject createModelObject(Model model)
     glCreateBuffers(1, &object.vbo);
     glNamedBufferStorage(object.vbo, model.vertexCount * sizeof(Vertex), model.vertices, 0);
 
+    object.indexCount = model.indexCount;
+    object.lodCount   = model.lodCount;
+
+    object.axisRadius = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        object.boundsMin[i] = model.vertexCount ? INFINITY : 0.0f;
+        object.boundsMax[i] = model.vertexCount ? -INFINITY : 0.0f;
+    }
+
+    for (int v = 0; v < model.vertexCount; ++v) {
+        const float *position = model.vertices[v].positions;
+
+        for (int i = 0; i < 3; ++i) {
+            object.boundsMin[i] = fminf(object.boundsMin[i], position[i]);
+            object.boundsMax[i] = fmaxf(object.boundsMax[i], position[i]);
+        }
+
+        float radius = sqrtf(position[0] * position[0] + position[2] * position[2]);
+        object.axisRadius = fmaxf(object.axisRadius, radius);
+    }
+
+    unsigned lodIndexCount = 0;
+    for (int i = 0; i < model.lodCount; ++i) {
+        object.lodFirstIndices[i] = object.indexCount + lodIndexCount;
+        object.lodIndexCounts[i]  = model.lods[i].indexCount;
+        object.lodErrors[i]       = model.lods[i].error;
+        lodIndexCount += model.lods[i].indexCount;
+    }
+
     glCreateBuffers(1, &object.ebo);
-    glNamedBufferStorage(object.ebo, model.indexCount * sizeof(unsigned), model.indices, 0);
+    glNamedBufferStorage(
+            object.ebo,
+            (model.indexCount + lodIndexCount) * sizeof(unsigned),
+            NULL,
+            GL_DYNAMIC_STORAGE_BIT
+    );
+    glNamedBufferSubData(object.ebo, 0, model.indexCount * sizeof(unsigned), model.indices);
+    if (lodIndexCount)
+        glNamedBufferSubData(
+                object.ebo,
+                model.indexCount * sizeof(unsigned),
+                lodIndexCount * sizeof(unsigned),
+                model.lodIndices
+        );
 
     glCreateVertexArrays(1, &object.vao);
     glVertexArrayVertexBuffer(object.vao, 0, object.vbo, 0, sizeof(Vertex));
@@ -257,8 +536,6 @@ ModelObject createModelObject(Model model)
 
     glVertexArrayElementBuffer(object.vao, object.ebo);
 
-    object.indexCount = model.indexCount;
-
     return object;
 }
 
@@ -325,10 +602,33 @@ AnimatedObject createAnimatedObject(Animated animated)
     glVertexArrayElementBuffer(object.model.vao, object.model.ebo);
 
     object.model.indexCount = animated.model.indexCount;
+    object.model.lodCount   = 0;
 
     return object;
 }
 
+void allocateCubeTexture(unsigned texture, int size)
+{
+    glTextureStorage2D(texture, (int)log2(size) + 1, GL_RGBA8, size, size);
+
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+
+bool fillCubeTextureFace(unsigned texture, int face, TextureImage image)
+{
+    int levelCount = (int)log2(image.width) + 1;
+
+    fillTextureLevels(texture, face, image, levelCount);
+
+    return image.levelCount >= levelCount;
+}
+
+
 unsigned createCubeTexture(
         const char *pxPath,
         const char *nxPath,
@@ -339,47 +639,32 @@ unsigned createCubeTexture(
 ) {
     const char *paths[] = { pxPath, nxPath, pyPath, nyPath, pzPath, nzPath };
 
-    int width, height, channels;
-    uint8_t *images[6];
+    TextureImage images[6];
 
-    images[0] = loadImage(paths[0], &width, &height, &channels, false);
+    images[0] = loadTextureImage(paths[0], false);
 
-    assert(width == height);
+    assert(images[0].width == images[0].height);
 
     for (int i = 1; i < 6; ++i) {
-        int w, h, c;
-        images[i] = loadImage(paths[i], &w, &h, &c, false);
+        images[i] = loadTextureImage(paths[i], false);
 
-        assert(w == width);
-        assert(h == height);
-        assert(c == channels);
+        assert(images[i].width  == images[0].width);
+        assert(images[i].height == images[0].height);
     }
 
     unsigned texture;
     glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &texture);
-    glTextureStorage2D(texture, (int)log2(width) + 1, GL_RGBA8, width, height);
+    allocateCubeTexture(texture, images[0].width);
 
-    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTextureParameteri(texture, GL_TEXTURE_WRAP_R, GL_REPEAT);
-    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    bool mipmapped = true;
 
     for (int i = 0; i < 6; ++i) {
-        glTextureSubImage3D(
-                texture,
-                0,
-                0, 0, i,
-                width, height, 1,
-                GL_RGBA,
-                GL_UNSIGNED_BYTE,
-                images[i]
-        );
-
-        free(images[i]);
+        mipmapped &= fillCubeTextureFace(texture, i, images[i]);
+        freeTextureImage(images[i]);
     }
 
-    glGenerateTextureMipmap(texture);
+    if (!mipmapped)
+        glGenerateTextureMipmap(texture);
 
     return texture;
 }
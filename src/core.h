@@ -3,6 +3,7 @@
 
 #include "bag_engine.h"
 #include "res.h"
+#include "pack.h"
 
 #include <stdbool.h>
 
@@ -12,6 +13,17 @@ typedef struct
     unsigned vbo;
     unsigned ebo;
     unsigned indexCount;
+
+    /* NOTE: the simplified levels' indices follow the full ones in `ebo` */
+    int lodCount;
+    unsigned lodFirstIndices[MAX_MODEL_LOD_COUNT];
+    unsigned lodIndexCounts [MAX_MODEL_LOD_COUNT];
+    float    lodErrors      [MAX_MODEL_LOD_COUNT];
+
+    /* NOTE: the model's box, and how far it reaches from its y axis */
+    float boundsMin[3];
+    float boundsMax[3];
+    float axisRadius;
 } ModelObject;
 
 static inline void freeModelObject(ModelObject object)
@@ -48,8 +60,32 @@ void GLAPIENTRY openglCallback(
 void printContextInfo(void);
 
 int loadShader(const char *path, GLenum type);
+/* NOTE: links without waiting, the program can't be used before finishPrograms */
 int createProgram(const char *vertexPath, const char *fragmentPath);
+/* NOTE: checks every program since the last call, in the order the driver finishes them
+ *       when it compiles in parallel */
+void finishPrograms(void);
 uint8_t *loadImage(const char *path, int *width, int *height, int *channels, bool flip);
+
+typedef struct
+{
+    /* NOTE: RGBA, every level one after another */
+    const uint8_t *pixels;
+    int width;
+    int height;
+    /* NOTE: 1 when the mipmaps are left to glGenerateTextureMipmap */
+    int levelCount;
+
+    uint8_t *decoded;
+    Asset cooked;
+} TextureImage;
+
+/* NOTE: from the cooked texture when it's up to date, decoded from `path` otherwise */
+TextureImage loadTextureImage(const char *path, bool flip);
+void freeTextureImage(TextureImage image);
+
+/* NOTE: `texture` from glCreateTextures */
+void fillTexture(unsigned texture, TextureImage image);
 unsigned createTexture(const char *path);
 ModelObject createModelObject(Model model);
 ModelObject loadModelObject(const char *path);
@@ -65,10 +101,22 @@ unsigned createCubeTexture(
         const char *nzPath
 );
 
+/* NOTE: faces are filled one by one, the mipmaps are up to the caller once all are in,
+ *       unless every face came with them and returned true */
+void allocateCubeTexture(unsigned texture, int size);
+bool fillCubeTextureFace(unsigned texture, int face, TextureImage image);
+
 ModelObject createCubeModelObject(void);
 ModelObject createBoxModelObject(void);
 
 
 #define BOX_INDEX_COUNT 36
 
+#define MAX_PENDING_PROGRAM_COUNT 32
+
+/* NOTE: GL_KHR_parallel_shader_compile, glad was generated without extensions */
+#ifndef GL_COMPLETION_STATUS_KHR
+    #define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 #endif
@@ -7,12 +7,16 @@
 #include "audio.h"
 #include "gui.h"
 #include "settings.h"
+#include "loader.h"
 
 
 Player player;
 Game game;
 Level level;
 
+Arena levelArena;
+Arena frameArena;
+
 
 static const char *soundPaths[SoundCount] = {
     [VineThudSound]       = "res/vine_thud.wav",       
@@ -29,16 +33,62 @@ static const char *soundPaths[SoundCount] = {
 static_assert(length(soundPaths) == SoundCount,
               "unfilled sound path");
 
+/* NOTE: kept as ADPCM, about a fourth of the memory, where the noise doesn't show */
+static const bool soundsCompressed[SoundCount] = {
+    [VineThudSound]       = true,
+    [Bite87Sound]         = false,
+    [SSAmmoPickupSound]   = false,
+    [Bruh2Sound]          = true,
+    [GulpSound]           = false,
+    [StoneHitSound]       = true,
+    [HappyWheelsWinSound] = true,
+    [SteveRevSound]       = true,
+    [LandSound]           = false,
+};
+
+static_assert(length(soundsCompressed) == SoundCount,
+              "unfilled sound compression");
+
+
+Sound gameSound(SoundID id)
+{
+    return (Sound) {
+        .data   = game.sounds[id],
+        .blocks = game.soundBlocks[id],
+        .end    = game.soundLengths[id],
+        .times  = 1,
+    };
+}
+
 
 void emitSound(SoundID id, float volume)
 {
-    playSound((Sound) {
-        .data  = game.sounds[id],
-        .end   = game.soundLengths[id],
-        .volL  = volume,
-        .volR  = volume,
-        .times = 1,
-    });
+    emitSoundScheduled(id, volume, 0.0);
+}
+
+
+void emitSoundScheduled(SoundID id, float volume, double time)
+{
+    Sound sound = gameSound(id);
+    sound.volL = sound.volR = volume;
+    sound.time = time;
+
+    playSound(sound);
+}
+
+
+SoundHandle emitSoundAt(SoundID id, float volume, Vector position, SoundPriority priority)
+{
+    Sound sound = gameSound(id);
+    sound.volL       = sound.volR = volume;
+    sound.positional = true;
+    sound.x          = position.x;
+    sound.y          = position.y;
+    sound.z          = position.z;
+    sound.radius     = SOUND_RADIUS;
+    sound.priority   = priority;
+
+    return playSound(sound);
 }
 
 
@@ -68,7 +118,7 @@ static_assert(length(pickupScales) == PickupCount,
               "unfilled pickup scales");
 
 
-bool pickupHealth(void)
+bool pickupHealth(Vector position)
 {
     if (player.hp < PLAYER_HP_FULL) {
         player.hp += 50;
@@ -76,7 +126,7 @@ bool pickupHealth(void)
         if (player.hp > PLAYER_HP_FULL)
             player.hp = PLAYER_HP_FULL;
 
-        emitSound(GulpSound, 0.5f);
+        emitSoundAt(GulpSound, 0.5f, position, SoundPriorityNormal);
 
         return true;
     }
@@ -85,21 +135,21 @@ bool pickupHealth(void)
 }
 
 
-bool pickupAmmo(void)
+bool pickupAmmo(Vector position)
 {
     player.gatlingAmmo += 50;
 
-    emitSound(SSAmmoPickupSound, 0.5f);
+    emitSoundAt(SSAmmoPickupSound, 0.5f, position, SoundPriorityNormal);
 
     return true;
 }
 
 
-bool pickupHead(void)
+bool pickupHead(Vector position)
 {
     ++player.carryHeadCount;
 
-    emitSound(Bruh2Sound, 0.5f);
+    emitSoundAt(Bruh2Sound, 0.5f, position, SoundPriorityNormal);
 
     return true;
 }
@@ -270,19 +320,48 @@ static Rect pauseButtonRects[PauseButtonCount];
 static PauseButtonID pauseSelectedButton = NO_BUTTON;
 
 
-
-// TODO: remove me
-static float timePassed = 0.0f;
-
 static unsigned staticProgram;
 static unsigned staticUBO;
 static Matrix staticMatrixBuffer[MAX_STATIC_INSTANCE_COUNT];
+/* NOTE: instances of every type grouped by LOD, the draws go through these to the matrices */
+static unsigned staticIdUBO;
+static unsigned staticIdBuffer[2 * MAX_STATIC_INSTANCE_COUNT];
+
+typedef struct
+{
+    int lodCounts[MAX_MODEL_LOD_COUNT + 1];
+    int impostorCount;
+} StaticGroups;
+
+static unsigned impostorProgram;
+static unsigned impostorBakeProgram;
 
 static unsigned mobProgram;
+static unsigned mobDQProgram;
 static unsigned mobUBO;
+/* NOTE: counted in vec4s, a matrix takes 4 and a dual quaternion 2 */
 static int mobBonePoolTaken;
-static Matrix mobBonePool[MOB_BONE_POOL_SIZE];
+static union {
+    Matrix matrices[MOB_BONE_POOL_SIZE];
+    Vector vectors [MOB_BONE_POOL_SIZE * 4];
+} mobBonePool;
 static JointTransform mobTransformScratch[MAX_BONES_PER_MOB];
+static PoseBatch      mobPoseBatch;
+static_assert(MAX_BONES_PER_MOB <= MAX_POSE_BONES, "mob armatures don't fit the pose batch");
+static DualQuaternion mobDQScratch[MAX_BONES_PER_MOB];
+
+/* armature space poses at both ends of the current LOD interval */
+static DualQuaternion mobPoseCache[MobCount * MAX_MOBS_PER_TYPE][2][MAX_BONES_PER_MOB];
+
+static const int animationLODPeriods[] = {
+    [AnimationLODFull]    = 1,
+    [AnimationLODHalf]    = 2,
+    [AnimationLODQuarter] = 4,
+    [AnimationLODFrozen]  = 0,
+};
+
+static_assert(length(animationLODPeriods) == AnimationLODCount,
+              "unfilled animation LOD period");
 
 static bool fireDown = false;
 
@@ -331,6 +410,8 @@ void levelLoad(LevelID id)
         case LevelBruh:  levelBruhLoad(); break;
         case LevelCount: break;
     }
+
+    arenaReport(&levelArena);
 }
 
 
@@ -341,6 +422,8 @@ void levelUnload(LevelID id)
         case LevelCount: break;
     }
 
+    arenaReset(&levelArena);
+
     level.filePath = NULL;
 
     for (MobType type = 0; type < MobCount; ++type)
@@ -349,6 +432,37 @@ void levelUnload(LevelID id)
 }
 
 
+/* NOTE: whatever is taken from the assets once they're in */
+static void linkGameAssets(void)
+{
+    /* NOTE: the worm has no idle clip, it holds the first key */
+    game.mobClips[MobWorm][MobStateWalking] = (Animation) {
+        .start = game.mobArmatures[MobWorm].keyTimes[0],
+        .end   = game.mobArmatures[MobWorm].keyTimes[2],
+    };
+    game.mobClips[MobWorm][MobStateIdle] = (Animation) {
+        .start = game.mobArmatures[MobWorm].keyTimes[0],
+        .end   = game.mobArmatures[MobWorm].keyTimes[0],
+    };
+    /* NOTE: jerks into the middle of its stride and back */
+    game.mobFlinches[MobWorm] = (Animation) {
+        .start = game.mobArmatures[MobWorm].keyTimes[0],
+        .end   = game.mobArmatures[MobWorm].keyTimes[1],
+    };
+
+    brugAnimation = (Animation) {
+        .start = brugArmature.keyTimes[0],
+        .end   = brugArmature.keyTimes[2],
+        .time  = 0.0f
+    };
+
+    game.pickupObjects[HeadPickup] = (Object) {
+        .model = game.head,
+        .texture = game.headTexture
+    };
+}
+
+
 void initGame(void)
 {
     player = (Player) {
@@ -359,9 +473,12 @@ void initGame(void)
         .tryJump = true
     };
 
+    arenaInit(&levelArena, "level", LEVEL_ARENA_SIZE);
+    arenaInit(&frameArena, "frame", FRAME_ARENA_SIZE);
+
 
-    game.defaultTerrainAtlas = createTexture("res/terrain_atlas.png");
-    game.defaultSkybox = createCubeTexture(
+    loadTextureAsync(&game.defaultTerrainAtlas, "res/terrain_atlas.png");
+    loadCubeTextureAsync(&game.defaultSkybox, (const char *[6]) {
             "res/Maskonaive2/posx.png",
             "res/Maskonaive2/negx.png",
 
@@ -370,7 +487,7 @@ void initGame(void)
 
             "res/Maskonaive2/posz.png",
             "res/Maskonaive2/negz.png"
-    );
+    });
 
 
     game.skyboxProgram = createProgram(
@@ -404,12 +521,12 @@ void initGame(void)
     );
 
     // FIXME: at least free me
-    game.gatling     = loadModelObject("res/gatling_barrel.model");
-    game.gatlingBase = loadModelObject("res/gatling_base.model");
-    game.glock       = loadModelObject("res/glock_top.model");
-    game.glockBase   = loadModelObject("res/glock_base.model");
+    loadModelAsync(&game.gatling,     "res/gatling_barrel.model");
+    loadModelAsync(&game.gatlingBase, "res/gatling_base.model");
+    loadModelAsync(&game.glock,       "res/glock_top.model");
+    loadModelAsync(&game.glockBase,   "res/glock_base.model");
 
-    game.gunTexture = createTexture("res/glock.png");
+    loadTextureAsync(&game.gunTexture, "res/glock.png");
 
 
     // FIXME: at least free me
@@ -421,11 +538,29 @@ void initGame(void)
 
     glBindBufferBase(GL_UNIFORM_BUFFER, 2, staticUBO);
 
+    staticIdUBO = createBufferObject(
+        2 * MAX_STATIC_INSTANCE_COUNT * sizeof(unsigned),
+        NULL,
+        GL_DYNAMIC_STORAGE_BIT
+    );
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, 4, staticIdUBO);
+
     staticProgram = createProgram(
             "shaders/static_vertex.glsl",
             "shaders/static_fragment.glsl"
     );
 
+    impostorProgram = createProgram(
+            "shaders/impostor_vertex.glsl",
+            "shaders/impostor_fragment.glsl"
+    );
+
+    impostorBakeProgram = createProgram(
+            "shaders/impostor_bake_vertex.glsl",
+            "shaders/impostor_bake_fragment.glsl"
+    );
+
 
     // FIXME: pls
     mobUBO = createBufferObject(
@@ -441,17 +576,14 @@ void initGame(void)
             "shaders/animated_fragment.glsl"
     );
 
-    // TODO: refactor out
-    Animated animated = animatedLoad("res/worm.animated");
-    game.mobArmatures[MobWorm] = animated.armature;
-
-    game.mobObjects[MobWorm] = (MobObject) {
-        createAnimatedObject(animated),
-        createTexture("res/worm.png")
-    };
+    mobDQProgram = createProgram(
+            "shaders/mob_dq_vertex.glsl",
+            "shaders/animated_fragment.glsl"
+    );
 
-    modelFree(animated.model);
-    free(animated.vertexWeights);
+    // TODO: refactor out
+    loadAnimatedAsync(&game.mobObjects[MobWorm].animated, &game.mobArmatures[MobWorm], "res/worm.animated");
+    loadTextureAsync(&game.mobObjects[MobWorm].texture, "res/worm.png");
 
 
     // TODO: test (remove)
@@ -461,31 +593,22 @@ void initGame(void)
             "shaders/animated_fragment.glsl"
     );
 
-    Animated brugAnim = animatedLoad("res/brug.animated");
-    brugArmature = brugAnim.armature;
-
-    brugAnimated = createAnimatedObject(brugAnim);
-    brugTexture = createTexture("res/brug.png");
-
-    modelFree(brugAnim.model);
-    free(brugAnim.vertexWeights);
+    loadAnimatedAsync(&brugAnimated, &brugArmature, "res/brug.animated");
+    loadTextureAsync(&brugTexture, "res/brug.png");
 
     brugTransform = (ModelTransform) { 0.0f, 0.0f, 0.0f, 2.0f },
     brugTransform.rx = -M_PI / 2;
-    brugAnimation = (Animation) {
-        .start = brugArmature.timeStamps[0],
-        .end   = brugArmature.timeStamps[2],
-        .time  = 0.0f
-    };
 
     // =============
 
-    for (int i = 0; i < SoundCount; ++i)
-        game.sounds[i] = loadWAV(soundPaths[i], game.soundLengths + i);
+    for (int i = 0; i < SoundCount; ++i) {
+        loadSoundAsync(game.sounds + i, soundsCompressed[i] ? game.soundBlocks + i : NULL,
+                       game.soundLengths + i, soundPaths[i]);
+    }
 
 
     // FIXME:
-    game.guiAtlas = createTexture("res/gui_atlas.png");
+    loadTextureAsync(&game.guiAtlas, "res/gui_atlas.png");
 
 
     game.lightProgram = createProgram(
@@ -493,29 +616,23 @@ void initGame(void)
             "shaders/light_fragment.glsl"
     );
 
-    game.platform = loadModelObject("res/platform.model");
-    game.platformTexture = createTexture("res/platform.png");
+    loadModelAsync(&game.platform, "res/platform.model");
+    loadTextureAsync(&game.platformTexture, "res/platform.png");
 
-    game.head        = loadModelObject("res/head.model");
-    game.headTexture = createTexture("res/stone.png");
+    loadModelAsync(&game.head, "res/head.model");
+    loadTextureAsync(&game.headTexture, "res/stone.png");
 
-    game.pickupObjects[HealthPickup] = (Object) {
-        .model = loadModelObject("res/energy.model"),
-        .texture = createTexture("res/monser.png")
-    };
+    loadModelAsync(&game.pickupObjects[HealthPickup].model, "res/energy.model");
+    loadTextureAsync(&game.pickupObjects[HealthPickup].texture, "res/monser.png");
     game.pickupNames[HealthPickup] = "Health";
 
-    game.pickupObjects[AmmoPickup] = (Object) {
-        .model = loadModelObject("res/ammo.model"),
-        .texture = createTexture("res/ammo.png")
-    };
+    loadModelAsync(&game.pickupObjects[AmmoPickup].model, "res/ammo.model");
+    loadTextureAsync(&game.pickupObjects[AmmoPickup].texture, "res/ammo.png");
     game.pickupNames[AmmoPickup] = "Ammo";
 
-    game.pickupObjects[HeadPickup] = (Object) {
-        .model = game.head,
-        .texture = game.headTexture
-    };
     game.pickupNames[HeadPickup] = "Head";
+
+    loaderThen(linkGameAssets);
 }
 
 
@@ -556,6 +673,10 @@ void exitGame(void)
     glDeleteProgram(game.textureProgram);
     glDeleteProgram(game.lightProgram);
     glDeleteProgram(game.metalProgram);
+    glDeleteProgram(mobProgram);
+    glDeleteProgram(mobDQProgram);
+    glDeleteProgram(impostorProgram);
+    glDeleteProgram(impostorBakeProgram);
 
     for (int i = 0; i < MobCount; ++i) {
         armatureFree(game.mobArmatures[i]);
@@ -568,8 +689,17 @@ void exitGame(void)
         glDeleteTextures(1, &(game.pickupObjects[i].texture));
     }
 
-    for (int i = 0; i < SoundCount; ++i)
+    for (int i = 0; i < level.statsTypeCount; ++i)
+        freeImpostor(level.statsTypeImpostor[i]);
+
+    for (int i = 0; i < SoundCount; ++i) {
         free(game.sounds[i]);
+        free(game.soundBlocks[i]);
+    }
+
+    arenaReport(&frameArena);
+    arenaFree(&levelArena);
+    arenaFree(&frameArena);
 }
 
 
@@ -580,10 +710,22 @@ void gameInsertStaticObject(Object object, ColliderType collider, const char *na
     level.statsTypeObjects [level.statsTypeCount] = object;
     level.statsTypeCollider[level.statsTypeCount] = collider;
     level.statsTypeName    [level.statsTypeCount] = name;
+    level.statsTypeImpostor[level.statsTypeCount] = (Impostor) { 0 };
     ++level.statsTypeCount;
 }
 
 
+void gameBakeImpostors(void)
+{
+    for (int i = 0; i < level.statsTypeCount; ++i) {
+        Object object = level.statsTypeObjects[i];
+
+        if (!level.statsTypeImpostor[i].albedo)
+            level.statsTypeImpostor[i] = createImpostor(&object.model, object.texture, impostorBakeProgram);
+    }
+}
+
+
 void gameAddStatic(int statID, ModelTransform transform)
 {
     assert(level.statsInstanceCount < MAX_STATIC_INSTANCE_COUNT);
@@ -753,8 +895,12 @@ void addMob(MobType type, ModelTransform trans, Animation anim)
     level.mobAnimations[pos] = anim;
     level.mobTransforms[pos] = trans;
     level.mobStates    [pos] = MobStateWalking;
+    level.mobFades     [pos] = 1.0f;
     level.mobAttackTOs [pos] = 0.0f;
+    level.mobFlinchTOs [pos] = 0.0f;
     level.mobHPs       [pos] = mobStartingHPs[type];
+    level.mobAnimLODs  [pos] = AnimationLODFull;
+    level.mobAnimFrames[pos] = -1;
 
     ++level.mobTypeCounts[type];
 }
@@ -768,8 +914,42 @@ void removeMob(MobType type, int index)
     level.mobAnimations[pos] = level.mobAnimations[last];
     level.mobTransforms[pos] = level.mobTransforms[last];
     level.mobStates    [pos] = level.mobStates    [last];
+    level.mobFadeAnimations[pos] = level.mobFadeAnimations[last];
+    level.mobFades     [pos] = level.mobFades     [last];
     level.mobAttackTOs [pos] = level.mobAttackTOs [last];
+    level.mobFlinchTOs [pos] = level.mobFlinchTOs [last];
     level.mobHPs       [pos] = level.mobHPs       [last];
+    level.mobAnimLODs  [pos] = level.mobAnimLODs  [last];
+    level.mobAnimFrames[pos] = level.mobAnimFrames[last];
+
+    if (level.mobAnimFrames[pos] >= 0)
+        memcpy(mobPoseCache[pos], mobPoseCache[last], sizeof(mobPoseCache[pos]));
+}
+
+
+/* crossfades from the current clip into the one of `state` */
+static void setMobState(int mobID, MobType type, MobState state)
+{
+    if (level.mobStates[mobID] == state)
+        return;
+
+    /* NOTE: a fade that is still running gets cut, the previous clip is mostly faded in anyway */
+    level.mobFadeAnimations[mobID] = level.mobAnimations[mobID];
+    level.mobAnimations    [mobID] = game.mobClips[type][state];
+    level.mobStates        [mobID] = state;
+    level.mobFades         [mobID] = 0.0f;
+    level.mobAnimFrames    [mobID] = -1;
+}
+
+
+/* size of one mob's bone palette in vec4s */
+static int getMobBoneStride(MobType type)
+{
+    int boneCount = game.mobArmatures[type].boneCount;
+
+    return game.skinningMode == SkinningMatrices
+         ? boneCount * 4
+         : boneCount * 2 + 1;
 }
 
 
@@ -887,7 +1067,8 @@ void processPlayerInput(float vx, float vz, bool jump, float dt)
     if (!player.inJump && player.walkTime > WALK_LENGTH) {
         player.walkTime -= WALK_LENGTH;
 
-        emitSound(LandSound, 0.5f);
+        /* NOTE: this step ends at game.time + dt, the step fell `walkTime` before it */
+        emitSoundScheduled(LandSound, 0.5f, game.time + dt - player.walkTime);
     }
 
     if (player.y < height + groundTolerance) {
@@ -1047,8 +1228,12 @@ void playerShoot(int damage)
 
     if (pos != -1) {
         level.mobHPs[pos] -= damage;
-        if (level.mobHPs[pos] <= 0)
+        if (level.mobHPs[pos] <= 0) {
             removeMob(pos / MAX_MOBS_PER_TYPE, pos % MAX_MOBS_PER_TYPE);
+        } else {
+            level.mobFlinchTOs [pos] = MOB_FLINCH_TIME;
+            level.mobAnimFrames[pos] = -1;
+        }
     }
 }
 
@@ -1120,13 +1305,11 @@ void menuProcessMouse(bagE_Mouse *m)
             if (id == pauseSelectedButton)
                 return;
 
-            playSound((Sound) {
-                .data  = game.sounds[VineThudSound],
-                .end   = game.soundLengths[VineThudSound] / 16,
-                .volL  = 0.15f,
-                .volR  = 0.15f,
-                .times = 1,
-            });
+            /* NOTE: kept even, so it ends on a whole frame */
+            Sound sound = gameSound(VineThudSound);
+            sound.end  = sound.end / 16 & ~(size_t)1;
+            sound.volL = sound.volR = 0.15f;
+            playSound(sound);
 
             pauseSelectedButton = id;
             return;
@@ -1137,9 +1320,255 @@ void menuProcessMouse(bagE_Mouse *m)
 }
 
 
+static AnimationLOD selectAnimationLOD(ModelTransform transform)
+{
+    float dx = transform.x - camState.x;
+    float dy = transform.y - camState.y;
+    float dz = transform.z - camState.z;
+    float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+    float radius   = MOB_THICKNESS * transform.scale;
+
+    if (distance <= radius || appState.windowHeight == 0)
+        return AnimationLODFull;
+
+    float tanHalfFov = tanf(camState.fov * (float)M_PI / 360.0f);
+    float aspect     = (float)appState.windowWidth / appState.windowHeight;
+
+    /* cone around the view direction enclosing the whole frustum */
+    float coneAngle = atanf(tanHalfFov * sqrtf(1.0f + aspect * aspect))
+                    + asinf(radius / distance);
+
+    if (coneAngle < M_PI) {
+        float forward[3] = {
+            sinf(camState.yaw) * cosf(camState.pitch),
+           -sinf(camState.pitch),
+           -cosf(camState.yaw) * cosf(camState.pitch),
+        };
+        float toMob[3] = { dx, dy, dz };
+
+        if (dot(forward, toMob) < cosf(coneAngle) * distance)
+            return AnimationLODFrozen;
+    }
+
+    float screenSize = radius / (distance * tanHalfFov);
+
+    if (screenSize > ANIMATION_LOD_FULL_SIZE)
+        return AnimationLODFull;
+    if (screenSize > ANIMATION_LOD_HALF_SIZE)
+        return AnimationLODHalf;
+
+    return AnimationLODQuarter;
+}
+
+
+/* NOTE: the coarsest level whose error stays under STATIC_LOD_PIXEL_ERROR,
+ *       `pixelScale` is how many pixels a unit covers one unit away */
+static int selectStaticLOD(const ModelObject *model, float scale, float distance, float pixelScale)
+{
+    int lod = 0;
+    while (lod < model->lodCount
+        && model->lodErrors[lod] * scale * pixelScale <= STATIC_LOD_PIXEL_ERROR * distance)
+        ++lod;
+
+    return lod;
+}
+
+
+/* NOTE: fills staticIdBuffer type after type, meshes LOD after LOD up front and impostors
+ *       MAX_STATIC_INSTANCE_COUNT further in, the ones fading between them are in both */
+static void groupStatics(StaticGroups *groups)
+{
+    const uint8_t noMesh = UINT8_MAX;
+
+    float pixelScale = appState.windowHeight / (2.0f * tanf(camState.fov * (float)M_PI / 360.0f));
+    size_t scratchMark = arenaMark(&frameArena);
+    uint8_t *lods = arenaAlloc(&frameArena, MAX_STATIC_INSTANCE_COUNT);
+
+    for (int typeID = 0; typeID < level.statsTypeCount; ++typeID) {
+        const ModelObject *model = &level.statsTypeObjects[typeID].model;
+        StaticGroups *group = groups + typeID;
+        int offset = level.statsTypeOffsets[typeID];
+        int count  = getStaticCount(typeID);
+
+        int lodOffsets[MAX_MODEL_LOD_COUNT + 1];
+
+        *group = (StaticGroups) { 0 };
+
+        for (int statOff = offset; statOff < offset + count; ++statOff) {
+            ModelTransform transform = level.statsTransforms[statOff];
+
+            float dx = transform.x - camState.x;
+            float dy = transform.y - camState.y;
+            float dz = transform.z - camState.z;
+            float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+            lods[statOff] = noMesh;
+
+            if (distance < STATIC_IMPOSTOR_DISTANCE + STATIC_IMPOSTOR_FADE) {
+                lods[statOff] = (uint8_t)selectStaticLOD(model, transform.scale, distance, pixelScale);
+                ++group->lodCounts[lods[statOff]];
+            }
+
+            if (distance > STATIC_IMPOSTOR_DISTANCE)
+                staticIdBuffer[MAX_STATIC_INSTANCE_COUNT + offset + group->impostorCount++] = statOff;
+        }
+
+        for (int lod = 0, next = offset; lod <= MAX_MODEL_LOD_COUNT; ++lod) {
+            lodOffsets[lod] = next;
+            next += group->lodCounts[lod];
+        }
+
+        for (int statOff = offset; statOff < offset + count; ++statOff)
+            if (lods[statOff] != noMesh)
+                staticIdBuffer[lodOffsets[lods[statOff]]++] = statOff;
+    }
+
+    arenaRewind(&frameArena, scratchMark);
+
+    glNamedBufferSubData(
+            staticIdUBO,
+            0,
+            sizeof(unsigned) * level.statsInstanceCount,
+            staticIdBuffer
+    );
+
+    glNamedBufferSubData(
+            staticIdUBO,
+            sizeof(unsigned) * MAX_STATIC_INSTANCE_COUNT,
+            sizeof(unsigned) * level.statsInstanceCount,
+            staticIdBuffer + MAX_STATIC_INSTANCE_COUNT
+    );
+}
+
+
+/* fills mobTransformScratch with the local bone transforms `ahead` seconds from now */
+static void computeMobTransforms(int mobID, MobType type, float ahead)
+{
+    const Armature *armature = game.mobArmatures + type;
+    float fade = fminf(level.mobFades[mobID] + ahead / MOB_STATE_FADE_TIME, 1.0f);
+
+    poseClear(&mobPoseBatch, armature->boneCount);
+
+    if (fade < 1.0f)
+        poseAccumulate(&mobPoseBatch, armature, getAnimationTime(level.mobFadeAnimations[mobID], ahead), 1.0f - fade);
+    poseAccumulate(&mobPoseBatch, armature, getAnimationTime(level.mobAnimations[mobID], ahead), fade);
+
+    float flinch = level.mobFlinchTOs[mobID] - ahead;
+    if (flinch > 0.0f) {
+        Animation clip = game.mobFlinches[type];
+        poseAddLayer(&mobPoseBatch, armature, clip.end, clip.start, sinf((float)M_PI * flinch / MOB_FLINCH_TIME));
+    }
+
+    poseStore(&mobPoseBatch, mobTransformScratch);
+}
+
+
+static void computeMobPose(DualQuaternion *output, int mobID, MobType type, float ahead)
+{
+    computeMobTransforms(mobID, type, ahead);
+    computeArmatureDualQuaternions(
+            dualQuaternionIdentity(),
+            output,
+            mobTransformScratch,
+            game.mobArmatures + type,
+            0
+    );
+}
+
+
+/* Reduced rate animation. The pose is sampled once per LOD period, one period
+ * ahead, and interpolated in between so that the stepping is not visible. */
+static void computeMobPoseLOD(int mobID, MobType type, AnimationLOD lod, float dt)
+{
+    int boneCount = game.mobArmatures[type].boneCount;
+    DualQuaternion (*poses)[MAX_BONES_PER_MOB] = mobPoseCache[mobID];
+
+    AnimationLOD current = level.mobAnimLODs[mobID];
+    int frame = level.mobAnimFrames[mobID];
+
+    /* time went on without the cache being updated */
+    if (current == AnimationLODFull || (current == AnimationLODFrozen && lod != current))
+        frame = -1;
+
+    if (lod == AnimationLODFrozen) {
+        if (frame < 0)
+            computeMobPose(poses[1], mobID, type, 0.0f);
+
+        memcpy(mobDQScratch, poses[1], sizeof(DualQuaternion) * boneCount);
+
+        level.mobAnimLODs  [mobID] = AnimationLODFrozen;
+        level.mobAnimFrames[mobID] = 0;
+        return;
+    }
+
+    if (frame < 0 || frame >= animationLODPeriods[current]) {
+        if (frame < 0)
+            computeMobPose(poses[1], mobID, type, 0.0f);
+
+        memcpy(poses[0], poses[1], sizeof(DualQuaternion) * boneCount);
+        computeMobPose(poses[1], mobID, type, animationLODPeriods[lod] * dt);
+
+        current = lod;
+        frame = 0;
+    }
+
+    float blend = (float)frame / animationLODPeriods[current];
+
+    for (int i = 0; i < boneCount; ++i)
+        mobDQScratch[i] = dualQuaternionNLerp(poses[0][i], poses[1][i], blend);
+
+    level.mobAnimLODs  [mobID] = current;
+    level.mobAnimFrames[mobID] = frame + 1;
+}
+
+
+/* writes armature space `pose` combined with `transform` at `offset` in the bone pool */
+static void writeMobPalette(int offset, ModelTransform transform, const DualQuaternion *pose, int boneCount)
+{
+    if (game.skinningMode == SkinningMatrices) {
+        Matrix modelMat = modelTransformToMatrix(transform);
+        Matrix *out = mobBonePool.matrices + offset / 4;
+
+        for (int bone = 0; bone < boneCount; ++bone)
+            out[bone] = dualQuaternionToMatrix(pose[bone]);
+
+        matricesMultiplyLeft(out, &modelMat, out, boneCount);
+
+        return;
+    }
+
+    DualQuaternion modelDQ = modelTransformToDualQuaternion(transform);
+    Vector *out = mobBonePool.vectors + offset;
+
+    /* uniform scale is applied to the vertex before the bone transform,
+     * which is the same as scaling the translation of each bone */
+    *(out++) = (Vector) {{ transform.scale, 0.0f, 0.0f, 0.0f }};
+
+    for (int bone = 0; bone < boneCount; ++bone) {
+        DualQuaternion dq = pose[bone];
+        for (int j = 0; j < 4; ++j)
+            dq.dual.data[j] *= transform.scale;
+
+        dq = dualQuaternionMultiply(modelDQ, dq);
+
+        *(out++) = (Vector) {{ dq.real.x, dq.real.y, dq.real.z, dq.real.w }};
+        *(out++) = (Vector) {{ dq.dual.x, dq.dual.y, dq.dual.z, dq.dual.w }};
+    }
+}
+
+
 void updateGame(float dt)
 {
-    timePassed += dt;
+    /* NOTE: switched here so a frame is updated and rendered in the same mode */
+    if (game.skinningModeToggled) {
+        game.skinningMode = (game.skinningMode + 1) % SkinningModeCount;
+        game.skinningModeToggled = false;
+    }
+
+    game.time += dt;
+    setAudioClock(game.time);
+
+    setSoundListener(camState.x, camState.y, camState.z, camState.yaw);
 
     selectVertex(
             camState.x, camState.y, camState.z,
@@ -1163,7 +1592,8 @@ void updateGame(float dt)
                 &level.terrain,
                 level.atlasViews,
                 chunkPos % MAX_MAP_DIM,
-                chunkPos / MAX_MAP_DIM
+                chunkPos / MAX_MAP_DIM,
+                &frameArena
         );
     }
 
@@ -1173,8 +1603,7 @@ void updateGame(float dt)
     if (level.recalculateStats) {
         level.recalculateStats = false;
 
-        for (int i = 0; i < level.statsInstanceCount; ++i)
-            staticMatrixBuffer[i] = modelTransformToMatrix(level.statsTransforms[i]);
+        modelTransformsToMatrices(staticMatrixBuffer, level.statsTransforms, level.statsInstanceCount);
 
         glNamedBufferSubData(
                 staticUBO,
@@ -1263,6 +1692,12 @@ void updateGame(float dt)
             if (level.mobAttackTOs[mobID] < 0.0f)
                 level.mobAttackTOs[mobID] = 0.0f;
 
+            /* NOTE: a mob that stopped to bite waits out the margin, or it would flip clips at the edge */
+            bool walking = toPlayerDistance < MOB_CHASE_RADIUS && toPlayerDistance >=
+                           (level.mobStates[mobID] == MobStateWalking ? MOB_BITE_RANGE : MOB_BITE_RANGE + MOB_CHASE_MARGIN);
+
+            setMobState(mobID, type, walking ? MobStateWalking : MobStateIdle);
+
             if (toPlayerDistance < MOB_BITE_RANGE) {
                 if (level.mobAttackTOs[mobID] == 0.0f && player.hp > 0) {
                     level.mobAttackTOs[mobID] = MOB_ATTACK_TO;
@@ -1271,9 +1706,10 @@ void updateGame(float dt)
                     if (player.hp < 0)
                         player.hp = 0;
 
-                    emitSound(Bite87Sound, 0.5f);
+                    ModelTransform t = level.mobTransforms[mobID];
+                    emitSoundAt(Bite87Sound, 0.5f, (Vector) {{ t.x, t.y, t.z, 1.0f }}, SoundPriorityHigh);
                 }
-            } else if (toPlayerDistance < MOB_CHASE_RADIUS) {
+            } else if (walking) {
                 toPlayerX /= toPlayerDistance;
                 toPlayerZ /= toPlayerDistance;
 
@@ -1326,30 +1762,47 @@ void updateGame(float dt)
     for (MobType type = 0; type < MobCount; ++type) {
         int count = level.mobTypeCounts[type];
         int boneCount = game.mobArmatures[type].boneCount;
+        int stride = getMobBoneStride(type);
 
         for (int i = 0; i < count; ++i) {
-            assert(mobBonePoolTaken + boneCount < MOB_BONE_POOL_SIZE);
+            assert(mobBonePoolTaken + stride <= MOB_BONE_POOL_SIZE * 4);
 
             int mobID = type * MAX_MOBS_PER_TYPE + i;
 
             updateAnimation(level.mobAnimations + mobID, dt);
-            Animation anim = level.mobAnimations[mobID];
-            computePoseTransforms(
-                    game.mobArmatures + type,
-                    mobTransformScratch,
-                    anim.start + anim.time
-            );
+            if (level.mobFades[mobID] < 1.0f) {
+                updateAnimation(level.mobFadeAnimations + mobID, dt);
+                level.mobFades[mobID] = fminf(level.mobFades[mobID] + dt / MOB_STATE_FADE_TIME, 1.0f);
+            }
+            level.mobFlinchTOs[mobID] = fmaxf(level.mobFlinchTOs[mobID] - dt, 0.0f);
 
-            Matrix modelMat = modelTransformToMatrix(level.mobTransforms[mobID]);
-            computeArmatureMatrices(
-                    modelMat,
-                    mobBonePool + mobBonePoolTaken,
-                    mobTransformScratch,
-                    game.mobArmatures + type,
-                    0
-            );
+            ModelTransform transform = level.mobTransforms[mobID];
+
+            AnimationLOD lod = selectAnimationLOD(transform);
+
+            if (lod != AnimationLODFull) {
+                computeMobPoseLOD(mobID, type, lod, dt);
+                writeMobPalette(mobBonePoolTaken, transform, mobDQScratch, boneCount);
+            } else if (game.skinningMode == SkinningMatrices) {
+                computeMobTransforms(mobID, type, 0.0f);
+
+                Matrix modelMat = modelTransformToMatrix(transform);
+                computeArmatureMatrices(
+                        modelMat,
+                        mobBonePool.matrices + mobBonePoolTaken / 4,
+                        mobTransformScratch,
+                        game.mobArmatures + type,
+                        0
+                );
+            } else {
+                computeMobPose(mobDQScratch, mobID, type, 0.0f);
+                writeMobPalette(mobBonePoolTaken, transform, mobDQScratch, boneCount);
+            }
+
+            if (lod == AnimationLODFull)
+                level.mobAnimLODs[mobID] = AnimationLODFull;
 
-            mobBonePoolTaken += boneCount;
+            mobBonePoolTaken += stride;
         }
     }
 
@@ -1387,17 +1840,25 @@ void updateGame(float dt)
 
             player.gatlingTO -= GATLING_FIRE_RATE * dt;
             if (player.gatlingTO < 0.0f) {
-                player.gatlingTO = 1.0f;
+                /* NOTE: the remainder carries over, so shots keep the exact rate
+                 *       instead of rounding up to whole steps */
+                double shotTime = game.time + player.gatlingTO / GATLING_FIRE_RATE;
+                player.gatlingTO += 1.0f;
 
                 if (player.gatlingAmmo > 0) {
                     playerShoot(10);
-                    playSound((Sound) {
-                        .data  = game.sounds[VineThudSound],
-                        .end   = game.soundLengths[VineThudSound] / 8,
-                        .volL  = 0.25f,
-                        .volR  = 0.25f,
-                        .times = 1,
-                    });
+                    /* NOTE: the first to go when the voices run out */
+                    Sound sound = gameSound(VineThudSound);
+                    sound.end        = sound.end / 8 & ~(size_t)1;
+                    sound.volL       = sound.volR = 0.25f;
+                    sound.positional = true;
+                    sound.x          = player.x;
+                    sound.y          = player.y;
+                    sound.z          = player.z;
+                    sound.radius     = SOUND_RADIUS;
+                    sound.priority   = SoundPriorityLow;
+                    sound.time       = shotTime;
+                    playSound(sound);
                     --player.gatlingAmmo;
                 }
             }
@@ -1427,7 +1888,7 @@ void updateGame(float dt)
         float distS = distXS + distYS + distZS;
 
         if (distS < PICKUP_RADIUS * PICKUP_RADIUS) {
-            if (pickupActions[level.pickups[i]]()) {
+            if (pickupActions[level.pickups[i]](pos)) {
                 removePickup(i);
                 continue;
             }
@@ -1566,33 +2027,72 @@ void renderGame(void)
     }
 
     /* render statics */
+    StaticGroups staticGroups[MAX_STATIC_TYPE_COUNT];
+    groupStatics(staticGroups);
+
     glUseProgram(staticProgram);
+    glProgramUniform2f(staticProgram, 1, STATIC_IMPOSTOR_DISTANCE, STATIC_IMPOSTOR_FADE);
 
     for (int i = 0; i < level.statsTypeCount; ++i) {
         Object object = level.statsTypeObjects[i];
         glBindVertexArray(object.model.vao);
         glBindTextureUnit(0, object.texture);
 
-        glProgramUniform1ui(staticProgram, 0, level.statsTypeOffsets[i]);
+        unsigned firstID = level.statsTypeOffsets[i];
 
-        glDrawElementsInstanced(
-                GL_TRIANGLES,
-                object.model.indexCount,
-                GL_UNSIGNED_INT,
-                0,
-                getStaticCount(i)
-        );
+        for (int lod = 0; lod <= object.model.lodCount; ++lod) {
+            int count = staticGroups[i].lodCounts[lod];
+            if (!count)
+                continue;
+
+            glProgramUniform1ui(staticProgram, 0, firstID);
+            firstID += count;
+
+            unsigned firstIndex = lod ? object.model.lodFirstIndices[lod - 1] : 0;
+
+            glDrawElementsInstanced(
+                    GL_TRIANGLES,
+                    lod ? object.model.lodIndexCounts[lod - 1] : object.model.indexCount,
+                    GL_UNSIGNED_INT,
+                    (void *)(sizeof(unsigned) * firstIndex),
+                    count
+            );
+        }
+    }
+
+    /* NOTE: the quads are made up from gl_VertexID, any vertex array will do */
+    glUseProgram(impostorProgram);
+    glProgramUniform2f(impostorProgram, 2, STATIC_IMPOSTOR_DISTANCE, STATIC_IMPOSTOR_FADE);
+
+    for (int i = 0; i < level.statsTypeCount; ++i) {
+        int count = staticGroups[i].impostorCount;
+        if (!count)
+            continue;
+
+        Impostor impostor = level.statsTypeImpostor[i];
+        glBindVertexArray(level.statsTypeObjects[i].model.vao);
+        glBindTextureUnit(0, impostor.albedo);
+        glBindTextureUnit(1, impostor.normals);
+
+        glProgramUniform1ui(impostorProgram, 0, MAX_STATIC_INSTANCE_COUNT + level.statsTypeOffsets[i]);
+        glProgramUniform3f(impostorProgram, 1, impostor.radius, impostor.bottom, impostor.top);
+
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
     }
 
     /* render mobs */
     glNamedBufferSubData(
             mobUBO,
             0,
-            sizeof(Matrix) * mobBonePoolTaken,
-            (float*)mobBonePool
+            sizeof(Vector) * mobBonePoolTaken,
+            mobBonePool.vectors
     );
 
-    glUseProgram(mobProgram);
+    /* NOTE: mob_vertex.glsl indexes matrices, mob_dq_vertex.glsl vec4s */
+    unsigned skinProgram = game.skinningMode == SkinningMatrices ? mobProgram : mobDQProgram;
+    int      skinUnit    = game.skinningMode == SkinningMatrices ? 4 : 1;
+
+    glUseProgram(skinProgram);
 
     int mobOffset = 0;
     for (MobType type = 0; type < MobCount; ++type) {
@@ -1600,8 +2100,10 @@ void renderGame(void)
         glBindVertexArray(object.animated.model.vao);
         glBindTextureUnit(0, object.texture);
 
-        glProgramUniform1ui(mobProgram, 0, mobOffset);
-        glProgramUniform1ui(mobProgram, 1, game.mobArmatures[type].boneCount);
+        int stride = getMobBoneStride(type);
+
+        glProgramUniform1ui(skinProgram, 0, mobOffset / skinUnit);
+        glProgramUniform1ui(skinProgram, 1, stride / skinUnit);
 
         glDrawElementsInstanced(
                 GL_TRIANGLES,
@@ -1611,7 +2113,7 @@ void renderGame(void)
                 level.mobTypeCounts[type]
         );
 
-        mobOffset += level.mobTypeCounts[type] * game.mobArmatures[type].boneCount;
+        mobOffset += level.mobTypeCounts[type] * stride;
     }
 
     // TODO: test (remove)
@@ -1639,14 +2141,11 @@ void renderGame(void)
             if (level.pickups[i] == pickup) {
                 Vector pos = level.pickupPositions[i];
 
-                float scale = pickupScales[pickup];
-                Matrix modelMat = matrixScale(scale, scale, scale);
-
-                mul = matrixRotationY(game.pickupTime);
-                modelMat = matrixMultiply(&mul, &modelMat);
-
-                mul = matrixTranslation(pos.x, pos.y + 0.25f, pos.z);
-                modelMat = matrixMultiply(&mul, &modelMat);
+                Matrix modelMat = modelTransformToMatrix((ModelTransform) {
+                    .x = pos.x, .y = pos.y + 0.25f, .z = pos.z,
+                    .scale = pickupScales[pickup],
+                    .ry = game.pickupTime,
+                });
 
                 glProgramUniformMatrix4fv(game.textureProgram, 0, 1, GL_FALSE, modelMat.data);
                 glDrawElements(GL_TRIANGLES, object.model.indexCount, GL_UNSIGNED_INT, 0);
@@ -1768,23 +2267,24 @@ void renderGame(void)
 }
 
 
-Matrix modelTransformToMatrix(ModelTransform transform)
+/* NOTE: scale is ignored, dual quaternions can only represent rigid transforms */
+DualQuaternion modelTransformToDualQuaternion(ModelTransform transform)
 {
-    Matrix res = matrixScale(transform.scale, transform.scale, transform.scale);
+    Quaternion rot = quaternionAxisAngle(0.0f, 0.0f, 1.0f, transform.rz);
 
-    Matrix mul = matrixRotationZ(transform.rz);
-    res = matrixMultiply(&mul, &res);
+    Quaternion mul = quaternionAxisAngle(0.0f, 1.0f, 0.0f, transform.ry);
+    rot = quaternionMultiply(mul, rot);
 
-    mul = matrixRotationY(transform.ry);
-    res = matrixMultiply(&mul, &res);
+    mul = quaternionAxisAngle(1.0f, 0.0f, 0.0f, transform.rx);
+    rot = quaternionMultiply(mul, rot);
 
-    mul = matrixRotationX(transform.rx);
-    res = matrixMultiply(&mul, &res);
+    return dualQuaternionFrom(rot, transform.x, transform.y, transform.z);
+}
 
-    mul = matrixTranslation(transform.x, transform.y, transform.z);
-    res = matrixMultiply(&mul, &res);
 
-    return res;
+void toggleSkinningMode(void)
+{
+    game.skinningModeToggled = !game.skinningModeToggled;
 }
 
 
@@ -1892,13 +2392,10 @@ void spawnersBroadcast(SpawnerGroup group)
             continue;
 
         // FIXME: this currently works for worms only
-        float animLength = game.mobArmatures[MobWorm].timeStamps[2];
+        Animation anim = game.mobClips[MobWorm][MobStateWalking];
+        anim.time = ((anim.end - anim.start) / 10) * (rand() % 10);
 
-        addMob(MobWorm,
-                (ModelTransform) { s.x, s.y, s.z, 2.0f },
-                (Animation) { .start = game.mobArmatures[MobWorm].timeStamps[0],
-                              .end   = animLength,
-                              .time  = (animLength / 10) * (rand() % 10) });
+        addMob(MobWorm, (ModelTransform) { s.x, s.y, s.z, 2.0f }, anim);
 
         level.spawners[i].emitted = true;
     }
@@ -2545,3 +3042,52 @@ void renderGameOverlay(void)
         }
     }
 }
+
+
+#define DEBUG_FONT_SIZE 16
+/* the worst mix time shown is over this many frames */
+#define DEBUG_STATS_FRAMES 60
+
+void renderDebugOverlay(void)
+{
+    static float windowMax, shownMax;
+    static int windowFrames;
+
+    AudioStats stats = audioGetStats();
+
+    windowMax = fmaxf(windowMax, stats.mixTimeMax);
+    if (++windowFrames == DEBUG_STATS_FRAMES) {
+        shownMax     = windowMax;
+        windowMax    = 0.0f;
+        windowFrames = 0;
+    }
+
+    /* NOTE: a mix over half the period leaves little room before the device starves */
+    bool atRisk = stats.periodTime > 0.0f && shownMax > stats.periodTime * 0.5f;
+
+    Color textColor = {{ 1.0f, 1.0f, 1.0f, 1.0f }};
+    Color riskColor = {{ 1.0f, 0.2f, 0.2f, 1.0f }};
+
+    char lines[6][64];
+    snprintf(lines[0], 64, "mix %.2f ms, worst %.2f of %.2f ms",
+             stats.mixTime * 1e3f, shownMax * 1e3f, stats.periodTime * 1e3f);
+    snprintf(lines[1], 64, "voices %d, mixed %d", stats.voiceCount, stats.mixedVoiceCount);
+    snprintf(lines[2], 64, "peak %3.0f%% %3.0f%%", stats.peakL * 100.0f, stats.peakR * 100.0f);
+    snprintf(lines[3], 64, "latency %.1f ms", stats.outputLatency * 1e3f);
+    snprintf(lines[4], 64, "xruns %u, stream underruns %u", stats.xrunCount, stats.streamUnderruns);
+    snprintf(lines[5], 64, "skinning %s",
+             game.skinningMode == SkinningMatrices ? "matrices" : "dual quaternions");
+
+    guiBeginRect();
+    guiDrawRect(0, 0, 40 * (DEBUG_FONT_SIZE / 2), DEBUG_FONT_SIZE * (int)length(lines),
+                (Color) {{ 0.0f, 0.0f, 0.0f, 0.5f }});
+
+    guiBeginText();
+    for (int i = 0; i < (int)length(lines); ++i) {
+        Color color = (i == 0 && atRisk) || (i == 2 && fmaxf(stats.peakL, stats.peakR) > 1.0f)
+                    ? riskColor
+                    : textColor;
+
+        guiDrawText(lines[i], 0, i * DEBUG_FONT_SIZE, DEBUG_FONT_SIZE / 2, DEBUG_FONT_SIZE, 0, color);
+    }
+}
@@ -6,6 +6,8 @@
 #include "core.h"
 #include "state.h"
 #include "animation.h"
+#include "audio.h"
+#include "impostor.h"
 
 #include <stdbool.h>
 
@@ -19,17 +21,17 @@ typedef enum
 
 
 #define MAX_STATIC_TYPE_COUNT 128
-/* NOTE: reflected in shaders/static_vertex.glsl */
+/* NOTE: reflected in shaders/static_vertex.glsl and shaders/impostor_vertex.glsl */
 #define MAX_STATIC_INSTANCE_COUNT 1024
+/* NOTE: in pixels, how far a static's LOD may stray from the full model on screen */
+#define STATIC_LOD_PIXEL_ERROR 1.0f
+/* NOTE: where statics start turning into impostors and how long they take to */
+#define STATIC_IMPOSTOR_DISTANCE 48.0f
+#define STATIC_IMPOSTOR_FADE     8.0f
 
-
-typedef struct
-{
-    float x, y, z;
-    float scale;
-    float rx, ry, rz;
-    float padding;
-} ModelTransform;
+/* NOTE: room for every chunk of the map, pages past what the level uses are never touched */
+#define LEVEL_ARENA_SIZE (MAX_MAP_DIM * MAX_MAP_DIM * (sizeof(ChunkHeights) + sizeof(ChunkTextures)))
+#define FRAME_ARENA_SIZE (1 << 20)
 
 
 typedef struct
@@ -84,11 +86,35 @@ typedef enum
     MobCount
 } MobType;
 
-/* NOTE: reflected in shaders/animated_vertex.glsl */
+/* NOTE: reflected in shaders/mob_vertex.glsl and shaders/mob_dq_vertex.glsl */
 #define MOB_BONE_POOL_SIZE 1024
 #define MAX_BONES_PER_MOB  128
 #define MAX_MOBS_PER_TYPE  64
 
+typedef enum
+{
+    SkinningMatrices,
+    /* quaternion + translation per bone, half the upload of SkinningMatrices */
+    SkinningDualQuaternions,
+
+    SkinningModeCount
+} SkinningMode;
+
+typedef enum
+{
+    AnimationLODFull,
+    AnimationLODHalf,
+    AnimationLODQuarter,
+    /* outside of the view, pose is not updated at all */
+    AnimationLODFrozen,
+
+    AnimationLODCount
+} AnimationLOD;
+
+/* NOTE: in fractions of screen height covered by the mob */
+#define ANIMATION_LOD_FULL_SIZE 0.2f
+#define ANIMATION_LOD_HALF_SIZE 0.08f
+
 typedef enum
 {
     MobStateWalking,
@@ -101,8 +127,11 @@ typedef enum
 #define MOB_SPEED 5.0f
 #define MOB_CHASE_RADIUS 32.0f
 #define MOB_BITE_RANGE 2.0f
+#define MOB_CHASE_MARGIN 0.5f
 #define MOB_ATTACK_TO 1.0f
 #define MOB_THICKNESS 1.0f
+#define MOB_STATE_FADE_TIME 0.25f
+#define MOB_FLINCH_TIME 0.3f
 
 
 typedef enum
@@ -156,7 +185,7 @@ typedef enum
 #define PICKUP_SPEED 2.0f
 #define PICKUP_RADIUS 1.5f
 
-typedef bool (*PickupAction)(void);
+typedef bool (*PickupAction)(Vector position);
 
 
 #define WALK_LENGTH 0.3f
@@ -177,6 +206,9 @@ typedef enum
     SoundCount
 } SoundID;
 
+/* world sounds can't be heard further than this */
+#define SOUND_RADIUS 64.0f
+
 typedef struct
 {
     bool gaming;
@@ -234,13 +266,24 @@ typedef struct
 
     Armature       mobArmatures[MobCount];
     MobObject      mobObjects  [MobCount];
+    Animation      mobClips    [MobCount][MobStateCount];
+    /* NOTE: layered over the clip when a mob gets shot, the key at `end` relative to `start` */
+    Animation      mobFlinches [MobCount];
+    SkinningMode   skinningMode;
+    /* NOTE: set by toggleSkinningMode, applied at the start of updateGame */
+    bool           skinningModeToggled;
 
     float pickupTime;           // FIXME: move?
     Object      pickupObjects[PickupCount];
     const char *pickupNames  [PickupCount];
 
+    /* NOTE: a sound is either PCM in `sounds` or ADPCM in `soundBlocks` */
     uint64_t soundLengths[SoundCount];
     int16_t *sounds      [SoundCount];
+    uint8_t *soundBlocks [SoundCount];
+
+    /* NOTE: in seconds, advanced by updateGame, scheduled sounds are timed against it */
+    double time;
 } Game;
 
 extern Game game;
@@ -266,6 +309,7 @@ typedef struct
     Object       statsTypeObjects [MAX_STATIC_TYPE_COUNT];
     ColliderType statsTypeCollider[MAX_STATIC_TYPE_COUNT];
     const char  *statsTypeName    [MAX_STATIC_TYPE_COUNT];
+    Impostor     statsTypeImpostor[MAX_STATIC_TYPE_COUNT];
 
     bool recalculateStats;
     int  statsInstanceCount;
@@ -280,8 +324,16 @@ typedef struct
     Animation      mobAnimations[MobCount * MAX_MOBS_PER_TYPE];
     ModelTransform mobTransforms[MobCount * MAX_MOBS_PER_TYPE];
     MobState       mobStates    [MobCount * MAX_MOBS_PER_TYPE];
+    /* clip of the previous state, faded out over MOB_STATE_FADE_TIME */
+    Animation      mobFadeAnimations[MobCount * MAX_MOBS_PER_TYPE];
+    float          mobFades     [MobCount * MAX_MOBS_PER_TYPE];
     float          mobAttackTOs [MobCount * MAX_MOBS_PER_TYPE];
+    /* time left of the flinch since the last hit, MOB_FLINCH_TIME long */
+    float          mobFlinchTOs [MobCount * MAX_MOBS_PER_TYPE];
     int            mobHPs       [MobCount * MAX_MOBS_PER_TYPE];
+    AnimationLOD   mobAnimLODs  [MobCount * MAX_MOBS_PER_TYPE];
+    /* frames into the current LOD interval, -1 when the cached poses are stale */
+    int            mobAnimFrames[MobCount * MAX_MOBS_PER_TYPE];
 
     int spawnerCount;
     Spawner spawners[MAX_SPAWNER_COUNT];
@@ -293,6 +345,11 @@ typedef struct
 
 extern Level level;
 
+/* NOTE: whatever lives as long as the level, reset in one go by levelUnload */
+extern Arena levelArena;
+/* NOTE: scratch space, given back before the function that took it returns */
+extern Arena frameArena;
+
 
 #define PLAYER_HP_FULL 100
 
@@ -309,12 +366,17 @@ static inline int getStaticChunkColliderCount(int chunkPos)
 }
 
 
-Matrix modelTransformToMatrix(ModelTransform transform);
+DualQuaternion modelTransformToDualQuaternion(ModelTransform transform);
 
 void initGame(void);
 void exitGame(void);
 
+/* plays once at full length, the rest is up to the caller */
+Sound gameSound(SoundID id);
 void emitSound(SoundID id, float volume);
+/* NOTE: starts on the frame of game time `time`, see Sound.time */
+void emitSoundScheduled(SoundID id, float volume, double time);
+SoundHandle emitSoundAt(SoundID id, float volume, Vector position, SoundPriority priority);
 
 void processPlayerInput(float vx, float vz, bool jump, float dt);
 
@@ -323,7 +385,9 @@ void updateMenu(float dt);
 void menuProcessMouse(bagE_Mouse *m);
 void renderGame(void);
 void renderGameOverlay(void);
+void renderDebugOverlay(void);
 void processEsc(void);
+void toggleSkinningMode(void);
 
 void levelsSaveCurrent(void);
 
@@ -334,6 +398,8 @@ void gameProcessButton(bagE_MouseButton *mb, bool down);
 void gameProcessWheel(bagE_MouseWheel *mw);
 
 void gameInsertStaticObject(Object object, ColliderType collider, const char *name);
+/* NOTE: for the static types inserted since the last call, after finishPrograms */
+void gameBakeImpostors(void);
 void gameAddStatic(int statID, ModelTransform transform);
 
 void staticsLoad(FILE *file);
@@ -3,6 +3,7 @@
 #include "bag_engine.h"
 #include "res.h"
 #include "core.h"
+#include "loader.h"
 
 GUI gui;
 
@@ -29,7 +30,7 @@ void initGUI(void)
             "shaders/image_fragment.glsl"
     );
 
-    gui.textFont = createTexture("res/font_base.png");
+    loadTextureAsync(&gui.textFont, "res/font_base.png");
 
 }
 
@@ -0,0 +1,124 @@
+#include "impostor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+
+static unsigned createViewTexture(void)
+{
+    unsigned texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(
+            texture,
+            IMPOSTOR_LEVEL_COUNT,
+            GL_RGBA8,
+            IMPOSTOR_VIEW_SIZE * IMPOSTOR_VIEW_COUNT,
+            IMPOSTOR_VIEW_SIZE
+    );
+
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    return texture;
+}
+
+
+/* NOTE: orthographic, looking at the axis from `angle` around it, x and z of the
+ *       model squeezed into the radius, y into the bottom and top */
+static void viewMatrix(float matrix[16], const Impostor *impostor, float angle)
+{
+    float s = sinf(angle), c = cosf(angle);
+    float halfHeight = (impostor->top - impostor->bottom) * 0.5f;
+    float middle     = (impostor->top + impostor->bottom) * 0.5f;
+
+    const float rows[16] = {
+        c / impostor->radius, 0.0f,              -s / impostor->radius, 0.0f,
+        0.0f,                 1.0f / halfHeight,  0.0f,                -middle / halfHeight,
+       -s / impostor->radius, 0.0f,              -c / impostor->radius, 0.0f,
+        0.0f,                 0.0f,               0.0f,                 1.0f,
+    };
+
+    for (int i = 0; i < 16; ++i)
+        matrix[i] = rows[i];
+}
+
+
+Impostor createImpostor(const ModelObject *model, unsigned texture, unsigned program)
+{
+    Impostor impostor = {
+        .radius = fmaxf(model->axisRadius, 1e-3f),
+        .bottom = model->boundsMin[1],
+        .top    = fmaxf(model->boundsMax[1], model->boundsMin[1] + 1e-3f),
+    };
+
+    impostor.albedo  = createViewTexture();
+    impostor.normals = createViewTexture();
+
+    unsigned depth;
+    glCreateRenderbuffers(1, &depth);
+    glNamedRenderbufferStorage(
+            depth,
+            GL_DEPTH_COMPONENT24,
+            IMPOSTOR_VIEW_SIZE * IMPOSTOR_VIEW_COUNT,
+            IMPOSTOR_VIEW_SIZE
+    );
+
+    unsigned framebuffer;
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, impostor.albedo, 0);
+    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT1, impostor.normals, 0);
+    glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+    const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glNamedFramebufferDrawBuffers(framebuffer, 2, drawBuffers);
+
+    if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "%s:%d: impostor framebuffer incomplete!\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    /* NOTE: zero where nothing covers the view, mip levels then stay premultiplied */
+    const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const float clearDepth = 1.0f;
+    glClearNamedFramebufferfv(framebuffer, GL_COLOR, 0, clearColor);
+    glClearNamedFramebufferfv(framebuffer, GL_COLOR, 1, clearColor);
+    glClearNamedFramebufferfv(framebuffer, GL_DEPTH, 0, &clearDepth);
+
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glUseProgram(program);
+    glBindVertexArray(model->vao);
+    glBindTextureUnit(0, texture);
+
+    for (int view = 0; view < IMPOSTOR_VIEW_COUNT; ++view) {
+        float matrix[16];
+        viewMatrix(matrix, &impostor, 2.0f * (float)M_PI * view / IMPOSTOR_VIEW_COUNT);
+
+        glViewport(view * IMPOSTOR_VIEW_SIZE, 0, IMPOSTOR_VIEW_SIZE, IMPOSTOR_VIEW_SIZE);
+        glProgramUniformMatrix4fv(program, 0, 1, GL_TRUE, matrix);
+        glDrawElements(GL_TRIANGLES, model->indexCount, GL_UNSIGNED_INT, 0);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &depth);
+
+    glGenerateTextureMipmap(impostor.albedo);
+    glGenerateTextureMipmap(impostor.normals);
+
+    return impostor;
+}
+
+
+void freeImpostor(Impostor impostor)
+{
+    glDeleteTextures(1, &impostor.albedo);
+    glDeleteTextures(1, &impostor.normals);
+}
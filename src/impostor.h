@@ -0,0 +1,29 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include "core.h"
+
+/* NOTE: views from around the model's y axis side by side in one row, reflected in
+ *       shaders/impostor_vertex.glsl */
+#define IMPOSTOR_VIEW_COUNT 8
+#define IMPOSTOR_VIEW_SIZE  128
+/* NOTE: down to 16 texels a view, smaller ones bleed into their neighbours */
+#define IMPOSTOR_LEVEL_COUNT 4
+
+/* NOTE: the colours and model space normals are premultiplied by coverage,
+ *       the quad reaches `radius` to either side of the axis and `bottom` to `top` */
+typedef struct
+{
+    unsigned albedo;
+    unsigned normals;
+    float radius;
+    float bottom;
+    float top;
+} Impostor;
+
+/* NOTE: renders the full model into its views, `program` is made from
+ *       shaders/impostor_bake_vertex.glsl and shaders/impostor_bake_fragment.glsl */
+Impostor createImpostor(const ModelObject *model, unsigned texture, unsigned program);
+void freeImpostor(Impostor impostor);
+
+#endif
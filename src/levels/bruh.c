@@ -53,7 +53,7 @@ void levelBruhLoad(void)
     FILE *file = fopen(lvlPath, "rb");
     file_check(file, lvlPath);
 
-    terrainLoad(&level.terrain, file);
+    terrainLoad(&level.terrain, file, &levelArena);
     invalidateAllChunks();
     staticsLoad(file);
     spawnersLoad(file);
@@ -87,26 +87,13 @@ void levelBruhLoad(void)
 
 void levelBruhUnload(void)
 {
-    terrainFreeChunkData(&level.terrain);
     terrainFreeChunkObjects(&level.terrain);
 }
 
 
-void levelBruhInit(void)
+/* NOTE: the statics are copies, they wait for the models to be uploaded */
+static void levelBruhInsertStatics(void)
 {
-    level.terrainAtlas = game.defaultTerrainAtlas;
-    level.skyboxCubemap = game.defaultSkybox;
-
-    // FIXME: and this
-    level.atlasViews = atlasViews;
-    level.atlasViewCount = 2;
-
-    for (int i = 0; i < TextureIDCount; ++i)
-        levelTextures[i] = createTexture(levelTexturePaths[i]);
-
-    for (int i = 0; i < ModelIDCount; ++i)
-        levelModels[i] = loadModelObject(levelModelPaths[i]);
-
     // FIXME: and also this
     gameInsertStaticObject((Object)   { .model   = levelModels  [ModelTree],
                                         .texture = levelTextures[TextureTree] },
@@ -122,7 +109,25 @@ void levelBruhInit(void)
                            (ColliderType) { true, { {{ 0.0f, 0.2f, 0.0f }},
                                                     {{ 0.6f, 0.4f, 0.6f }} } },
                             "Rock");
+}
+
+
+void levelBruhInit(void)
+{
+    level.terrainAtlas = game.defaultTerrainAtlas;
+    level.skyboxCubemap = game.defaultSkybox;
+
+    // FIXME: and this
+    level.atlasViews = atlasViews;
+    level.atlasViewCount = 2;
+
+    for (int i = 0; i < TextureIDCount; ++i)
+        loadTextureAsync(levelTextures + i, levelTexturePaths[i]);
+
+    for (int i = 0; i < ModelIDCount; ++i)
+        loadModelAsync(levelModels + i, levelModelPaths[i]);
 
+    loaderThen(levelBruhInsertStatics);
 }
 
 
@@ -0,0 +1,363 @@
+#include "linalg.h"
+
+#include "utils.h"
+
+#include <stddef.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define LINALG_X86
+    #define TARGET_SSE __attribute__((target("sse2")))
+    #define TARGET_AVX __attribute__((target("avx")))
+    #include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #define LINALG_X86
+    #define TARGET_SSE
+    #define TARGET_AVX
+    #include <immintrin.h>
+    #include <intrin.h>
+#endif
+
+
+static void modelTransformsToMatricesScalar(Matrix *output, const ModelTransform *transforms, int count)
+{
+    for (int i = 0; i < count; ++i)
+        output[i] = modelTransformToMatrix(transforms[i]);
+}
+
+
+static void matricesMultiplyScalar(Matrix *output, const Matrix *a, const Matrix *b, int count)
+{
+    for (int i = 0; i < count; ++i)
+        output[i] = matrixMultiply(a + i, b + i);
+}
+
+
+static void matricesMultiplyLeftScalar(Matrix *output, const Matrix *a, const Matrix *b, int count)
+{
+    Matrix left = *a;
+
+    for (int i = 0; i < count; ++i)
+        output[i] = matrixMultiply(&left, b + i);
+}
+
+
+#ifdef LINALG_X86
+
+/* Cody-Waite reduction by pi/2 and cephes minimax polynomials on [-pi/4, pi/4] */
+#define SINCOS_DP1  1.5703125f
+#define SINCOS_DP2  4.837512969970703125e-4f
+#define SINCOS_DP3  7.54978995489188216e-8f
+#define SINCOS_S0  -1.9515295891e-4f
+#define SINCOS_S1   8.3321608736e-3f
+#define SINCOS_S2  -1.6666654611e-1f
+#define SINCOS_C0   2.443315711809948e-5f
+#define SINCOS_C1  -1.388731625493765e-3f
+#define SINCOS_C2   4.166664568298827e-2f
+
+
+TARGET_SSE static inline __m128 selectSSE(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+
+TARGET_SSE static inline void sincosSSE(__m128 x, __m128 *sinOut, __m128 *cosOut)
+{
+    __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps((float)(2.0 / M_PI))));
+    __m128 j = _mm_cvtepi32_ps(quadrant);
+
+    x = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(SINCOS_DP1)));
+    x = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(SINCOS_DP2)));
+    x = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(SINCOS_DP3)));
+
+    __m128 x2 = _mm_mul_ps(x, x);
+
+    __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SINCOS_S0), x2), _mm_set1_ps(SINCOS_S1));
+    s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(SINCOS_S2));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, x2), x), x);
+
+    __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SINCOS_C0), x2), _mm_set1_ps(SINCOS_C1));
+    c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(SINCOS_C2));
+    c = _mm_mul_ps(_mm_mul_ps(c, x2), x2);
+    c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(x2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    __m128i one = _mm_set1_epi32(1);
+    __m128i two = _mm_set1_epi32(2);
+
+    __m128 swap    = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+    __m128 sinSign = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, two), two));
+    __m128 cosSign = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), two));
+
+    __m128 negative = _mm_set1_ps(-0.0f);
+    *sinOut = _mm_xor_ps(selectSSE(swap, c, s), _mm_and_ps(sinSign, negative));
+    *cosOut = _mm_xor_ps(selectSSE(swap, s, c), _mm_and_ps(cosSign, negative));
+}
+
+
+/* columns of four matrices from four vectors holding one component each */
+TARGET_SSE static inline void storeColumnsSSE(Matrix *output, int column, __m128 x, __m128 y, __m128 z, __m128 w)
+{
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(output[0].data + column * 4, x);
+    _mm_storeu_ps(output[1].data + column * 4, y);
+    _mm_storeu_ps(output[2].data + column * 4, z);
+    _mm_storeu_ps(output[3].data + column * 4, w);
+}
+
+
+TARGET_SSE static void modelTransformsToMatricesSSE(Matrix *output, const ModelTransform *transforms, int count)
+{
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        const float *t = (const float *)(transforms + i);
+
+        __m128 x  = _mm_loadu_ps(t),      rx = _mm_loadu_ps(t + 4);
+        __m128 y  = _mm_loadu_ps(t + 8),  ry = _mm_loadu_ps(t + 12);
+        __m128 z  = _mm_loadu_ps(t + 16), rz = _mm_loadu_ps(t + 20);
+        __m128 sc = _mm_loadu_ps(t + 24), pd = _mm_loadu_ps(t + 28);
+        _MM_TRANSPOSE4_PS(x, y, z, sc);
+        _MM_TRANSPOSE4_PS(rx, ry, rz, pd);
+
+        __m128 sx, cx, sy, cy, sz, cz;
+        sincosSSE(rx, &sx, &cx);
+        sincosSSE(ry, &sy, &cy);
+        sincosSSE(rz, &sz, &cz);
+
+        __m128 sxsy = _mm_mul_ps(sx, sy);
+        __m128 cxsy = _mm_mul_ps(cx, sy);
+        __m128 zero = _mm_setzero_ps();
+
+        storeColumnsSSE(output + i, 0,
+                _mm_mul_ps(sc, _mm_mul_ps(cy, cz)),
+                _mm_mul_ps(sc, _mm_add_ps(_mm_mul_ps(cx, sz), _mm_mul_ps(sxsy, cz))),
+                _mm_mul_ps(sc, _mm_sub_ps(_mm_mul_ps(sx, sz), _mm_mul_ps(cxsy, cz))),
+                zero);
+        storeColumnsSSE(output + i, 1,
+                _mm_sub_ps(zero, _mm_mul_ps(sc, _mm_mul_ps(cy, sz))),
+                _mm_mul_ps(sc, _mm_sub_ps(_mm_mul_ps(cx, cz), _mm_mul_ps(sxsy, sz))),
+                _mm_mul_ps(sc, _mm_add_ps(_mm_mul_ps(sx, cz), _mm_mul_ps(cxsy, sz))),
+                zero);
+        storeColumnsSSE(output + i, 2,
+                _mm_mul_ps(sc, sy),
+                _mm_sub_ps(zero, _mm_mul_ps(sc, _mm_mul_ps(sx, cy))),
+                _mm_mul_ps(sc, _mm_mul_ps(cx, cy)),
+                zero);
+        storeColumnsSSE(output + i, 3, x, y, z, _mm_set1_ps(1.0f));
+    }
+
+    modelTransformsToMatricesScalar(output + i, transforms + i, count - i);
+}
+
+
+/* NOTE: all of `b` is loaded before `output` is written, so they may alias */
+TARGET_SSE static inline void multiplySSE(float *output, const __m128 a[4], const float *b)
+{
+    __m128 right[4];
+    for (int j = 0; j < 4; ++j)
+        right[j] = _mm_loadu_ps(b + j * 4);
+
+    for (int j = 0; j < 4; ++j) {
+        __m128 r = _mm_mul_ps(a[0], _mm_shuffle_ps(right[j], right[j], 0x00));
+        r = _mm_add_ps(r, _mm_mul_ps(a[1], _mm_shuffle_ps(right[j], right[j], 0x55)));
+        r = _mm_add_ps(r, _mm_mul_ps(a[2], _mm_shuffle_ps(right[j], right[j], 0xaa)));
+        r = _mm_add_ps(r, _mm_mul_ps(a[3], _mm_shuffle_ps(right[j], right[j], 0xff)));
+        _mm_storeu_ps(output + j * 4, r);
+    }
+}
+
+
+TARGET_SSE static void matricesMultiplySSE(Matrix *output, const Matrix *a, const Matrix *b, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        __m128 columns[4];
+        for (int k = 0; k < 4; ++k)
+            columns[k] = _mm_loadu_ps(a[i].data + k * 4);
+
+        multiplySSE(output[i].data, columns, b[i].data);
+    }
+}
+
+
+TARGET_SSE static void matricesMultiplyLeftSSE(Matrix *output, const Matrix *a, const Matrix *b, int count)
+{
+    __m128 columns[4];
+    for (int k = 0; k < 4; ++k)
+        columns[k] = _mm_loadu_ps(a->data + k * 4);
+
+    for (int i = 0; i < count; ++i)
+        multiplySSE(output[i].data, columns, b[i].data);
+}
+
+
+/* two result columns per register, `a` columns are duplicated into both lanes */
+TARGET_AVX static inline void multiplyAVX(float *output, const __m256 a[4], const float *b)
+{
+    __m256 right[2] = { _mm256_loadu_ps(b), _mm256_loadu_ps(b + 8) };
+
+    for (int j = 0; j < 2; ++j) {
+        __m256 r = _mm256_mul_ps(a[0], _mm256_shuffle_ps(right[j], right[j], 0x00));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a[1], _mm256_shuffle_ps(right[j], right[j], 0x55)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a[2], _mm256_shuffle_ps(right[j], right[j], 0xaa)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a[3], _mm256_shuffle_ps(right[j], right[j], 0xff)));
+        _mm256_storeu_ps(output + j * 8, r);
+    }
+}
+
+
+TARGET_AVX static inline void loadColumnsAVX(__m256 columns[4], const Matrix *mat)
+{
+    for (int k = 0; k < 4; ++k) {
+        __m128 column = _mm_loadu_ps(mat->data + k * 4);
+        columns[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(column), column, 1);
+    }
+}
+
+
+TARGET_AVX static void matricesMultiplyAVX(Matrix *output, const Matrix *a, const Matrix *b, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        __m256 columns[4];
+        loadColumnsAVX(columns, a + i);
+
+        multiplyAVX(output[i].data, columns, b[i].data);
+    }
+}
+
+
+TARGET_AVX static void matricesMultiplyLeftAVX(Matrix *output, const Matrix *a, const Matrix *b, int count)
+{
+    __m256 columns[4];
+    loadColumnsAVX(columns, a);
+
+    for (int i = 0; i < count; ++i)
+        multiplyAVX(output[i].data, columns, b[i].data);
+}
+
+#endif
+
+
+typedef struct
+{
+    void (*transforms)(Matrix *, const ModelTransform *, int);
+    void (*multiply)(Matrix *, const Matrix *, const Matrix *, int);
+    void (*multiplyLeft)(Matrix *, const Matrix *, const Matrix *, int);
+} LinalgKernels;
+
+static const LinalgKernels linalgKernels[] = {
+    [LinalgKernelScalar] = {
+        modelTransformsToMatricesScalar,
+        matricesMultiplyScalar,
+        matricesMultiplyLeftScalar,
+    },
+#ifdef LINALG_X86
+    [LinalgKernelSSE] = {
+        modelTransformsToMatricesSSE,
+        matricesMultiplySSE,
+        matricesMultiplyLeftSSE,
+    },
+    /* NOTE: an 8 wide transform kernel measured no faster than the SSE one, only the multiplies gain */
+    [LinalgKernelAVX] = {
+        modelTransformsToMatricesSSE,
+        matricesMultiplyAVX,
+        matricesMultiplyLeftAVX,
+    },
+#else
+    [LinalgKernelAVX] = { 0 },
+#endif
+};
+
+static_assert(length(linalgKernels) == LinalgKernelCount,
+              "unfilled linalg kernel");
+
+static const char *linalgKernelNames[] = {
+    [LinalgKernelScalar] = "scalar",
+    [LinalgKernelSSE]    = "sse",
+    [LinalgKernelAVX]    = "avx",
+};
+
+static_assert(length(linalgKernelNames) == LinalgKernelCount,
+              "unfilled linalg kernel name");
+
+/* NOTE: -1 until the first call picks the best supported one */
+static int linalgKernel = -1;
+
+
+int linalgKernelSupported(LinalgKernel kernel)
+{
+    switch (kernel) {
+        case LinalgKernelScalar:
+            return 1;
+
+#if defined(LINALG_X86) && defined(__GNUC__)
+        case LinalgKernelSSE:
+            return __builtin_cpu_supports("sse2");
+        case LinalgKernelAVX:
+            return __builtin_cpu_supports("avx");
+#elif defined(LINALG_X86) && defined(_MSC_VER)
+        case LinalgKernelSSE: {
+            int info[4];
+            __cpuid(info, 1);
+            return (info[3] >> 26) & 1;
+        }
+        case LinalgKernelAVX: {
+            int info[4];
+            __cpuid(info, 1);
+            /* AVX and OSXSAVE, then the OS has to save ymm state */
+            if ((info[2] & (3 << 27)) != (3 << 27))
+                return 0;
+            return (_xgetbv(0) & 6) == 6;
+        }
+#endif
+
+        default:
+            return 0;
+    }
+}
+
+
+LinalgKernel linalgGetKernel(void)
+{
+    if (linalgKernel < 0) {
+        linalgKernel = LinalgKernelScalar;
+        for (int kernel = LinalgKernelCount - 1; kernel > LinalgKernelScalar; --kernel) {
+            if (linalgKernelSupported(kernel)) {
+                linalgKernel = kernel;
+                break;
+            }
+        }
+    }
+
+    return linalgKernel;
+}
+
+
+void linalgSetKernel(LinalgKernel kernel)
+{
+    assert(linalgKernelSupported(kernel));
+    linalgKernel = kernel;
+}
+
+
+const char *linalgKernelName(LinalgKernel kernel)
+{
+    return linalgKernelNames[kernel];
+}
+
+
+void modelTransformsToMatrices(Matrix *output, const ModelTransform *transforms, int count)
+{
+    linalgKernels[linalgGetKernel()].transforms(output, transforms, count);
+}
+
+
+void matricesMultiply(Matrix *output, const Matrix *a, const Matrix *b, int count)
+{
+    linalgKernels[linalgGetKernel()].multiply(output, a, b, count);
+}
+
+
+void matricesMultiplyLeft(Matrix *output, const Matrix *a, const Matrix *b, int count)
+{
+    linalgKernels[linalgGetKernel()].multiplyLeft(output, a, b, count);
+}
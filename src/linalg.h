@@ -153,6 +153,54 @@ static inline Matrix matrixMultiply(const Matrix *mat1, const Matrix *mat2)
 }
 
 
+typedef struct
+{
+    float x, y, z;
+    float scale;
+    float rx, ry, rz;
+    float padding;
+} ModelTransform;
+
+
+/* NOTE: closed form of T * Rx * Ry * Rz * S */
+static inline Matrix modelTransformToMatrix(ModelTransform transform)
+{
+    float sx = sinf(transform.rx), cx = cosf(transform.rx);
+    float sy = sinf(transform.ry), cy = cosf(transform.ry);
+    float sz = sinf(transform.rz), cz = cosf(transform.rz);
+    float s = transform.scale;
+
+    Matrix res = {{
+         s * (cy * cz), s * (cx * sz + sx * sy * cz), s * (sx * sz - cx * sy * cz), 0.0f,
+         s * (-cy * sz), s * (cx * cz - sx * sy * sz), s * (sx * cz + cx * sy * sz), 0.0f,
+         s * sy,         s * (-sx * cy),               s * (cx * cy),                0.0f,
+         transform.x,    transform.y,                  transform.z,                  1.0f,
+    }};
+    return res;
+}
+
+
+typedef enum
+{
+    LinalgKernelScalar,
+    LinalgKernelSSE,
+    LinalgKernelAVX,
+
+    LinalgKernelCount
+} LinalgKernel;
+
+/* NOTE: the best supported kernel is picked on first use, see linalg.c */
+LinalgKernel linalgGetKernel(void);
+int linalgKernelSupported(LinalgKernel kernel);
+void linalgSetKernel(LinalgKernel kernel);
+const char *linalgKernelName(LinalgKernel kernel);
+
+void modelTransformsToMatrices(Matrix *output, const ModelTransform *transforms, int count);
+/* output[i] = a[i] * b[i] */
+void matricesMultiply(Matrix *output, const Matrix *a, const Matrix *b, int count);
+/* output[i] = *a * b[i] */
+void matricesMultiplyLeft(Matrix *output, const Matrix *a, const Matrix *b, int count);
+
 
 static inline void printMatrix(const Matrix *mat)
 {
@@ -258,6 +306,161 @@ static inline Matrix quaternionToMatrix(Quaternion r)
 }
 
 
+static inline Quaternion quaternionMultiply(Quaternion a, Quaternion b)
+{
+    Quaternion res = {{
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+    }};
+    return res;
+}
+
+
+static inline Quaternion quaternionConjugate(Quaternion q)
+{
+    Quaternion res = {{ q.w, -q.x, -q.y, -q.z }};
+    return res;
+}
+
+
+static inline Quaternion quaternionAxisAngle(float x, float y, float z, float angle)
+{
+    float s = sinf(angle * 0.5f);
+    Quaternion res = {{ cosf(angle * 0.5f), x * s, y * s, z * s }};
+    return res;
+}
+
+
+/* NOTE: only the rotational part of `mat` is taken into account */
+static inline Quaternion matrixToQuaternion(const Matrix *mat)
+{
+    const float *m = mat->data;
+
+    /* column major, m[c * 4 + r] */
+    float m00 = m[0], m01 = m[4], m02 = m[8];
+    float m10 = m[1], m11 = m[5], m12 = m[9];
+    float m20 = m[2], m21 = m[6], m22 = m[10];
+
+    Quaternion res;
+    float trace = m00 + m11 + m22;
+
+    if (trace > 0.0f) {
+        float s = sqrtf(trace + 1.0f) * 2.0f;
+        res = (Quaternion) {{ 0.25f * s, (m21 - m12) / s, (m02 - m20) / s, (m10 - m01) / s }};
+    } else if (m00 > m11 && m00 > m22) {
+        float s = sqrtf(1.0f + m00 - m11 - m22) * 2.0f;
+        res = (Quaternion) {{ (m21 - m12) / s, 0.25f * s, (m01 + m10) / s, (m02 + m20) / s }};
+    } else if (m11 > m22) {
+        float s = sqrtf(1.0f + m11 - m00 - m22) * 2.0f;
+        res = (Quaternion) {{ (m02 - m20) / s, (m01 + m10) / s, 0.25f * s, (m12 + m21) / s }};
+    } else {
+        float s = sqrtf(1.0f + m22 - m00 - m11) * 2.0f;
+        res = (Quaternion) {{ (m10 - m01) / s, (m02 + m20) / s, (m12 + m21) / s, 0.25f * s }};
+    }
+
+    return res;
+}
+
+
+/* rigid transform, applies `real` rotation followed by the encoded translation */
+typedef struct
+{
+    Quaternion real;
+    Quaternion dual;
+} DualQuaternion;
+
+
+static inline DualQuaternion dualQuaternionIdentity(void)
+{
+    DualQuaternion res = {
+        {{ 1.0f, 0.0f, 0.0f, 0.0f }},
+        {{ 0.0f, 0.0f, 0.0f, 0.0f }},
+    };
+    return res;
+}
+
+
+static inline DualQuaternion dualQuaternionFrom(Quaternion rotation, float x, float y, float z)
+{
+    Quaternion t = {{ 0.0f, x * 0.5f, y * 0.5f, z * 0.5f }};
+
+    DualQuaternion res = {
+        rotation,
+        quaternionMultiply(t, rotation),
+    };
+    return res;
+}
+
+
+static inline DualQuaternion matrixToDualQuaternion(const Matrix *mat)
+{
+    return dualQuaternionFrom(
+            matrixToQuaternion(mat),
+            mat->data[12],
+            mat->data[13],
+            mat->data[14]
+    );
+}
+
+
+/* same order as matrixMultiply, `b` gets applied first */
+static inline DualQuaternion dualQuaternionMultiply(DualQuaternion a, DualQuaternion b)
+{
+    Quaternion d1 = quaternionMultiply(a.real, b.dual);
+    Quaternion d2 = quaternionMultiply(a.dual, b.real);
+
+    DualQuaternion res = {
+        quaternionMultiply(a.real, b.real),
+        {{ d1.w + d2.w, d1.x + d2.x, d1.y + d2.y, d1.z + d2.z }},
+    };
+    return res;
+}
+
+
+static inline DualQuaternion dualQuaternionNLerp(DualQuaternion a, DualQuaternion b, float blend)
+{
+    float dot = a.real.w * b.real.w + a.real.x * b.real.x
+              + a.real.y * b.real.y + a.real.z * b.real.z;
+    float blendI = 1.0f - blend;
+
+    if (dot < 0)
+        blend = -blend;
+
+    DualQuaternion res;
+    for (int i = 0; i < 4; ++i) {
+        res.real.data[i] = blendI * a.real.data[i] + blend * b.real.data[i];
+        res.dual.data[i] = blendI * a.dual.data[i] + blend * b.dual.data[i];
+    }
+
+    float invLength = 1.0f / sqrtf(res.real.w * res.real.w
+                                 + res.real.x * res.real.x
+                                 + res.real.y * res.real.y
+                                 + res.real.z * res.real.z);
+    for (int i = 0; i < 4; ++i) {
+        res.real.data[i] *= invLength;
+        res.dual.data[i] *= invLength;
+    }
+
+    return res;
+}
+
+
+static inline Matrix dualQuaternionToMatrix(DualQuaternion dq)
+{
+    /* quaternionToMatrix works with conjugated rotations */
+    Matrix res = quaternionToMatrix(quaternionConjugate(dq.real));
+
+    Quaternion t = quaternionMultiply(dq.dual, quaternionConjugate(dq.real));
+    res.data[12] = t.x * 2.0f;
+    res.data[13] = t.y * 2.0f;
+    res.data[14] = t.z * 2.0f;
+
+    return res;
+}
+
+
 static inline void positionLerp(float out[3], float a[3], float b[3], float blend)
 {
     float blendI = 1.0f - blend;
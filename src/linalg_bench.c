@@ -0,0 +1,149 @@
+#include "linalg.h"
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_COUNT 4096
+#define BENCH_RUNS  200
+
+static ModelTransform transforms[BENCH_COUNT];
+static Matrix left  [BENCH_COUNT];
+static Matrix right [BENCH_COUNT];
+static Matrix output[BENCH_COUNT];
+static Matrix expect[BENCH_COUNT];
+
+
+static float randomFloat(float min, float max)
+{
+    return min + (max - min) * ((float)rand() / RAND_MAX);
+}
+
+
+/* the way modelTransformToMatrix used to compose it */
+static Matrix composeTransform(ModelTransform transform)
+{
+    Matrix res = matrixScale(transform.scale, transform.scale, transform.scale);
+
+    Matrix mul = matrixRotationZ(transform.rz);
+    res = matrixMultiply(&mul, &res);
+
+    mul = matrixRotationY(transform.ry);
+    res = matrixMultiply(&mul, &res);
+
+    mul = matrixRotationX(transform.rx);
+    res = matrixMultiply(&mul, &res);
+
+    mul = matrixTranslation(transform.x, transform.y, transform.z);
+    res = matrixMultiply(&mul, &res);
+
+    return res;
+}
+
+
+static float maxError(void)
+{
+    float error = 0.0f;
+    for (int i = 0; i < BENCH_COUNT; ++i)
+        for (int j = 0; j < 16; ++j)
+            error = fmaxf(error, fabsf(output[i].data[j] - expect[i].data[j]));
+    return error;
+}
+
+
+static void report(const char *name, double seconds, float error)
+{
+    printf("%-28s %8.2f ns/item   max error %g\n",
+            name, seconds * 1e9 / ((double)BENCH_RUNS * BENCH_COUNT), error);
+}
+
+
+int main(void)
+{
+    srand(666);
+
+    for (int i = 0; i < BENCH_COUNT; ++i) {
+        transforms[i] = (ModelTransform) {
+            randomFloat(-100.0f, 100.0f), randomFloat(-100.0f, 100.0f), randomFloat(-100.0f, 100.0f),
+            randomFloat(0.5f, 4.0f),
+            randomFloat(-M_PI, M_PI), randomFloat(-M_PI, M_PI), randomFloat(-M_PI, M_PI),
+        };
+        left[i]  = composeTransform(transforms[i]);
+        right[i] = composeTransform(transforms[(i * 7 + 3) % BENCH_COUNT]);
+    }
+
+    /* transforms */
+    for (int i = 0; i < BENCH_COUNT; ++i)
+        expect[i] = composeTransform(transforms[i]);
+
+    double start = monotonicSeconds();
+    for (int run = 0; run < BENCH_RUNS; ++run)
+        for (int i = 0; i < BENCH_COUNT; ++i)
+            output[i] = composeTransform(transforms[i]);
+    report("transforms composed", monotonicSeconds() - start, maxError());
+
+    start = monotonicSeconds();
+    for (int run = 0; run < BENCH_RUNS; ++run)
+        for (int i = 0; i < BENCH_COUNT; ++i)
+            output[i] = modelTransformToMatrix(transforms[i]);
+    report("transforms closed form", monotonicSeconds() - start, maxError());
+
+    for (LinalgKernel kernel = 0; kernel < LinalgKernelCount; ++kernel) {
+        if (!linalgKernelSupported(kernel))
+            continue;
+        linalgSetKernel(kernel);
+
+        char name[64];
+        snprintf(name, sizeof(name), "transforms batch %s", linalgKernelName(kernel));
+
+        start = monotonicSeconds();
+        for (int run = 0; run < BENCH_RUNS; ++run)
+            modelTransformsToMatrices(output, transforms, BENCH_COUNT);
+        report(name, monotonicSeconds() - start, maxError());
+    }
+
+    /* multiply */
+    for (int i = 0; i < BENCH_COUNT; ++i)
+        expect[i] = matrixMultiply(left + i, right + i);
+
+    start = monotonicSeconds();
+    for (int run = 0; run < BENCH_RUNS; ++run)
+        for (int i = 0; i < BENCH_COUNT; ++i)
+            output[i] = matrixMultiply(left + i, right + i);
+    report("multiply single", monotonicSeconds() - start, maxError());
+
+    for (LinalgKernel kernel = 0; kernel < LinalgKernelCount; ++kernel) {
+        if (!linalgKernelSupported(kernel))
+            continue;
+        linalgSetKernel(kernel);
+
+        char name[64];
+        snprintf(name, sizeof(name), "multiply batch %s", linalgKernelName(kernel));
+
+        start = monotonicSeconds();
+        for (int run = 0; run < BENCH_RUNS; ++run)
+            matricesMultiply(output, left, right, BENCH_COUNT);
+        report(name, monotonicSeconds() - start, maxError());
+    }
+
+    /* multiply by a shared matrix, as bone palettes do */
+    for (int i = 0; i < BENCH_COUNT; ++i)
+        expect[i] = matrixMultiply(left, right + i);
+
+    for (LinalgKernel kernel = 0; kernel < LinalgKernelCount; ++kernel) {
+        if (!linalgKernelSupported(kernel))
+            continue;
+        linalgSetKernel(kernel);
+
+        char name[64];
+        snprintf(name, sizeof(name), "multiply left batch %s", linalgKernelName(kernel));
+
+        start = monotonicSeconds();
+        for (int run = 0; run < BENCH_RUNS; ++run)
+            matricesMultiplyLeft(output, left, right, BENCH_COUNT);
+        report(name, monotonicSeconds() - start, maxError());
+    }
+
+    return 0;
+}
@@ -0,0 +1,382 @@
+#include "loader.h"
+
+#include "utils.h"
+#include "audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <threads.h>
+
+
+typedef enum
+{
+    LoadTexture,
+    LoadCubeFace,
+    LoadModel,
+    LoadAnimated,
+    LoadSound,
+
+    LoadTypeCount
+} LoadType;
+
+static const char *loadTypeNames[] = {
+    [LoadTexture]  = "texture",
+    [LoadCubeFace] = "cube face",
+    [LoadModel]    = "model",
+    [LoadAnimated] = "animated",
+    [LoadSound]    = "sound",
+};
+
+static_assert(length(loadTypeNames) == LoadTypeCount, "unnamed load type");
+
+typedef struct
+{
+    LoadType type;
+    const char *path;
+
+    /* where the asset ends up */
+    union {
+        unsigned texture;
+        struct { int cube, face; };
+        ModelObject *model;
+        struct { AnimatedObject *object; Armature *armature; } animated;
+        struct { int16_t **samples; uint8_t **blocks; uint64_t *length; } sound;
+    };
+
+    /* NOTE: written by the worker, read by loaderFinish once it's done */
+    union {
+        TextureImage image;
+        Model loadedModel;
+        Animated loadedAnimated;
+    };
+
+    int worker;
+    /* in seconds since the first job */
+    double started, decoded;
+    /* in seconds, how long loaderFinish took to upload it */
+    double uploaded;
+} LoadJob;
+
+typedef struct
+{
+    unsigned texture;
+    int size;
+    int faceCount;
+    /* NOTE: every face was cooked */
+    bool mipmapped;
+} CubeLoad;
+
+static LoadJob jobs[MAX_LOAD_JOB_COUNT];
+static CubeLoad cubes[MAX_CUBE_LOAD_COUNT];
+static int cubeCount;
+
+static void (*thens[MAX_LOAD_THEN_COUNT])(void);
+static int thenCount;
+
+/* NOTE: the counts and `running` are under `lock`, the jobs past `nextJob` belong to
+ *       the GL thread, the ones taken to their worker until they're in `doneJobs` */
+static mtx_t lock;
+static cnd_t workReady;
+static cnd_t jobDone;
+static int jobCount;
+static int nextJob;
+static int doneJobs[MAX_LOAD_JOB_COUNT];
+static int doneCount;
+static bool running;
+
+static thrd_t workers[LOADER_THREAD_COUNT];
+static double epoch;
+
+
+static void decodeJob(LoadJob *job)
+{
+    switch (job->type) {
+        case LoadTexture:
+            job->image = loadTextureImage(job->path, true);
+            break;
+
+        case LoadCubeFace:
+            job->image = loadTextureImage(job->path, false);
+            break;
+
+        case LoadModel:
+            job->loadedModel = modelLoad(job->path);
+            break;
+
+        case LoadAnimated:
+            job->loadedAnimated = animatedLoad(job->path);
+            break;
+
+        case LoadSound: {
+            int16_t *samples = loadWAV(job->path, job->sound.length);
+
+            if (job->sound.blocks) {
+                *job->sound.blocks = encodeADPCM(samples, *job->sound.length);
+                free(samples);
+                samples = NULL;
+            }
+
+            *job->sound.samples = samples;
+        } break;
+
+        default:
+            unreachable();
+    }
+}
+
+
+static int runWorker(void *param)
+{
+    int worker = (int)(intptr_t)param;
+
+    mtx_lock(&lock);
+
+    for (;;) {
+        while (nextJob == jobCount && running)
+            cnd_wait(&workReady, &lock);
+
+        if (nextJob == jobCount)
+            break;
+
+        LoadJob *job = jobs + nextJob++;
+        mtx_unlock(&lock);
+
+        job->worker  = worker;
+        job->started = monotonicSeconds() - epoch;
+        decodeJob(job);
+        job->decoded = monotonicSeconds() - epoch;
+
+        mtx_lock(&lock);
+        doneJobs[doneCount++] = (int)(job - jobs);
+        cnd_signal(&jobDone);
+    }
+
+    mtx_unlock(&lock);
+
+    return 0;
+}
+
+
+static void startWorkers(void)
+{
+    epoch     = monotonicSeconds();
+    jobCount  = 0;
+    nextJob   = 0;
+    doneCount = 0;
+    cubeCount = 0;
+    running   = true;
+
+    if (mtx_init(&lock, mtx_plain) != thrd_success
+     || cnd_init(&workReady) != thrd_success
+     || cnd_init(&jobDone) != thrd_success) {
+        fprintf(stderr, "failed to create the loader's locks!\n");
+        exit(666);
+    }
+
+    for (intptr_t i = 0; i < LOADER_THREAD_COUNT; ++i) {
+        if (thrd_create(workers + i, runWorker, (void *)i) != thrd_success) {
+            fprintf(stderr, "failed to create a loader thread!\n");
+            exit(666);
+        }
+    }
+}
+
+
+static void submit(LoadJob job)
+{
+    if (!running)
+        startWorkers();
+
+    mtx_lock(&lock);
+
+    if (jobCount == MAX_LOAD_JOB_COUNT) {
+        fprintf(stderr, "%s:%d: too many assets loading at once! path: \"%s\".\n", __FILE__, __LINE__, job.path);
+        exit(666);
+    }
+
+    jobs[jobCount++] = job;
+    cnd_signal(&workReady);
+
+    mtx_unlock(&lock);
+}
+
+
+void loadTextureAsync(unsigned *texture, const char *path)
+{
+    glCreateTextures(GL_TEXTURE_2D, 1, texture);
+
+    submit((LoadJob) { .type = LoadTexture, .path = path, .texture = *texture });
+}
+
+
+void loadCubeTextureAsync(unsigned *texture, const char *paths[6])
+{
+    if (!running)
+        startWorkers();
+
+    if (cubeCount == MAX_CUBE_LOAD_COUNT) {
+        fprintf(stderr, "%s:%d: too many cube maps loading at once! path: \"%s\".\n", __FILE__, __LINE__, paths[0]);
+        exit(666);
+    }
+
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, texture);
+    cubes[cubeCount] = (CubeLoad) { .texture = *texture, .mipmapped = true };
+
+    for (int face = 0; face < 6; ++face)
+        submit((LoadJob) { .type = LoadCubeFace, .path = paths[face], .cube = cubeCount, .face = face });
+
+    ++cubeCount;
+}
+
+
+void loadModelAsync(ModelObject *object, const char *path)
+{
+    submit((LoadJob) { .type = LoadModel, .path = path, .model = object });
+}
+
+
+void loadAnimatedAsync(AnimatedObject *object, Armature *armature, const char *path)
+{
+    submit((LoadJob) {
+        .type     = LoadAnimated,
+        .path     = path,
+        .animated = { object, armature },
+    });
+}
+
+
+void loadSoundAsync(int16_t **samples, uint8_t **blocks, uint64_t *length, const char *path)
+{
+    submit((LoadJob) {
+        .type  = LoadSound,
+        .path  = path,
+        .sound = { samples, blocks, length },
+    });
+}
+
+
+void loaderThen(void (*callback)(void))
+{
+    if (thenCount == MAX_LOAD_THEN_COUNT) {
+        fprintf(stderr, "%s:%d: too many loader callbacks!\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    thens[thenCount++] = callback;
+}
+
+
+static void uploadJob(LoadJob *job)
+{
+    switch (job->type) {
+        case LoadTexture:
+            fillTexture(job->texture, job->image);
+            freeTextureImage(job->image);
+            break;
+
+        case LoadCubeFace: {
+            CubeLoad *cube = cubes + job->cube;
+
+            if (!cube->size) {
+                cube->size = job->image.width;
+                allocateCubeTexture(cube->texture, cube->size);
+            }
+
+            if (job->image.width != cube->size || job->image.height != cube->size) {
+                fprintf(stderr, "%s:%d: cube map faces have to be the same squares! path: \"%s\".\n",
+                        __FILE__, __LINE__, job->path);
+                exit(666);
+            }
+
+            if (!fillCubeTextureFace(cube->texture, job->face, job->image))
+                cube->mipmapped = false;
+            freeTextureImage(job->image);
+
+            if (++cube->faceCount == 6 && !cube->mipmapped)
+                glGenerateTextureMipmap(cube->texture);
+        } break;
+
+        case LoadModel:
+            *job->model = createModelObject(job->loadedModel);
+            modelFree(job->loadedModel);
+            break;
+
+        case LoadAnimated:
+            *job->animated.object   = createAnimatedObject(job->loadedAnimated);
+            *job->animated.armature = job->loadedAnimated.armature;
+            modelFree(job->loadedAnimated.model);
+            break;
+
+        case LoadSound:
+            break;
+
+        default:
+            unreachable();
+    }
+}
+
+
+static void printTimeline(double waited)
+{
+    double total = monotonicSeconds() - epoch;
+    double decoding = 0.0, uploading = 0.0;
+
+    for (int i = 0; i < jobCount; ++i) {
+        decoding  += jobs[i].decoded - jobs[i].started;
+        uploading += jobs[i].uploaded;
+    }
+
+    printf("loaded %d assets in %.1f ms, %.1f ms of decoding on %d threads, "
+           "%.1f ms uploading, %.1f ms waiting on them\n",
+           jobCount, total * 1e3, decoding * 1e3, LOADER_THREAD_COUNT, uploading * 1e3, waited * 1e3);
+
+    printf("  thread  start ms  decode ms  upload ms\n");
+    for (int i = 0; i < jobCount; ++i) {
+        const LoadJob *job = jobs + i;
+        printf("  %6d  %8.1f  %9.1f  %9.1f  %s %s\n",
+               job->worker, job->started * 1e3, (job->decoded - job->started) * 1e3,
+               job->uploaded * 1e3, loadTypeNames[job->type], job->path);
+    }
+}
+
+
+void loaderFinish(void)
+{
+    if (running) {
+        double waited = 0.0;
+
+        for (int doneRead = 0; doneRead < jobCount; ) {
+            double start = monotonicSeconds();
+
+            mtx_lock(&lock);
+            while (doneRead == doneCount)
+                cnd_wait(&jobDone, &lock);
+            LoadJob *job = jobs + doneJobs[doneRead++];
+            mtx_unlock(&lock);
+
+            double uploadStart = monotonicSeconds();
+            waited += uploadStart - start;
+
+            uploadJob(job);
+            job->uploaded = monotonicSeconds() - uploadStart;
+        }
+
+        mtx_lock(&lock);
+        running = false;
+        cnd_broadcast(&workReady);
+        mtx_unlock(&lock);
+
+        for (int i = 0; i < LOADER_THREAD_COUNT; ++i)
+            thrd_join(workers[i], NULL);
+
+        cnd_destroy(&jobDone);
+        cnd_destroy(&workReady);
+        mtx_destroy(&lock);
+
+        printTimeline(waited);
+    }
+
+    for (int i = 0; i < thenCount; ++i)
+        thens[i]();
+    thenCount = 0;
+}
@@ -0,0 +1,35 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "core.h"
+
+#include <stdint.h>
+
+/* NOTE: files are read and decoded on LOADER_THREAD_COUNT workers, while the
+ *       GL side of every asset is done by loaderFinish on the context's thread */
+#define LOADER_THREAD_COUNT  4
+#define MAX_LOAD_JOB_COUNT   128
+#define MAX_CUBE_LOAD_COUNT  4
+#define MAX_LOAD_THEN_COUNT  16
+
+/* NOTE: texture names are created right away and can be passed around,
+ *       their storage is filled in by loaderFinish */
+void loadTextureAsync(unsigned *texture, const char *path);
+/* NOTE: +x, -x, +y, -y, +z, -z, each face is decoded on its own */
+void loadCubeTextureAsync(unsigned *texture, const char *paths[6]);
+
+/* NOTE: only written by loaderFinish, copies have to be made from loaderThen */
+void loadModelAsync(ModelObject *object, const char *path);
+void loadAnimatedAsync(AnimatedObject *object, Armature *armature, const char *path);
+
+/* NOTE: ADPCM encoded into `blocks` when it's given, `samples` is NULL then */
+void loadSoundAsync(int16_t **samples, uint8_t **blocks, uint64_t *length, const char *path);
+
+/* runs at the end of loaderFinish, in the order given */
+void loaderThen(void (*callback)(void));
+
+/* NOTE: uploads assets as the workers finish them, returns once everything
+ *       is in and prints where the time went */
+void loaderFinish(void);
+
+#endif
@@ -12,6 +12,9 @@
 #include "gui.h"
 #include "splash.h"
 #include "settings.h"
+#include "pack.h"
+#include "loader.h"
+#include "program_cache.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -82,16 +85,39 @@ int bagE_main(int argc, char *argv[])
     // glEnable(GL_FRAMEBUFFER_SRGB);
 
 
-    initAudio();
+    AudioInfo audioInfo = { 0 };
+    bool isEditor = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--editor") == 0)
+            isEditor = true;
+        else if (strcmp(argv[i], "--low-latency-audio") == 0)
+            audioInfo.lowLatency = true;
+        else if (strcmp(argv[i], "--realtime-audio") == 0)
+            audioInfo.realTime = true;
+    }
+
+    /* NOTE: loose files under res/ and shaders/ are used without one */
+    packOpen(PACK_FILE);
+
+    initAudio(audioInfo);
     initState();
 
-    if (argc > 1)
-        gameState.isEditor = strcmp(argv[1], "--editor") == 0;
+    /* NOTE: initState clears the game state */
+    gameState.isEditor = isEditor;
 
     initGUI();
     initGame();
     initSplash();
 
+    /* NOTE: the inits above only queue their assets and programs, the driver
+     *       compiles while the loader uploads */
+    loaderFinish();
+    finishPrograms();
+    programCacheSave();
+
+    gameBakeImpostors();
+
     settingsLoad();
 
     unsigned camUBO = createBufferObject(
@@ -252,6 +278,9 @@ int bagE_main(int argc, char *argv[])
             renderGameOverlay();
         }
 
+        if (gameState.debugOverlay)
+            renderDebugOverlay();
+
         glEnable(GL_DEPTH_TEST);
 
 
@@ -265,6 +294,8 @@ int bagE_main(int argc, char *argv[])
     exitGame();
     exitGUI();
 
+    packClose();
+
     return 0;
 }
 
@@ -339,6 +370,16 @@ int bagE_eventHandler(bagE_Event *event)
                     if (!keyDown && !gameState.inSplash && gameState.isEditor)
                         levelsSaveCurrent();
                     break;
+
+                case KEY_F2:
+                    if (!keyDown)
+                        toggleSkinningMode();
+                    break;
+
+                case KEY_F3:
+                    if (!keyDown)
+                        gameState.debugOverlay = !gameState.debugOverlay;
+                    break;
             }
         } break;
 
@@ -0,0 +1,894 @@
+#include "mesh.h"
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+MeshStats meshStats(const unsigned *indices, int indexCount, int vertexCount)
+{
+    unsigned cache[MESH_STATS_CACHE_SIZE];
+    int cacheCount = 0, cacheHead = 0;
+    int missCount = 0;
+
+    for (int i = 0; i < indexCount; ++i) {
+        bool hit = false;
+
+        for (int j = 0; j < cacheCount && !hit; ++j)
+            hit = cache[j] == indices[i];
+
+        if (hit)
+            continue;
+
+        ++missCount;
+        cache[cacheHead] = indices[i];
+        cacheHead = (cacheHead + 1) % MESH_STATS_CACHE_SIZE;
+        if (cacheCount < MESH_STATS_CACHE_SIZE)
+            ++cacheCount;
+    }
+
+    return (MeshStats) {
+        .acmr = indexCount  ? (float)missCount / (indexCount / 3) : 0.0f,
+        .atvr = vertexCount ? (float)missCount / vertexCount : 0.0f,
+    };
+}
+
+
+static bool vertexEqual(const Vertex *vertices, const VertexWeight *weights, unsigned a, unsigned b)
+{
+    return !memcmp(vertices + a, vertices + b, sizeof(Vertex))
+        && (!weights || !memcmp(weights + a, weights + b, sizeof(VertexWeight)));
+}
+
+
+int meshWeld(unsigned *indices, int indexCount, Vertex *vertices, VertexWeight *weights, int vertexCount)
+{
+    /* NOTE: open addressing like obj_parser, a slot holds the kept vertex plus one */
+    unsigned mapCapacity = 1;
+    while (mapCapacity < 2 * (unsigned)vertexCount)
+        mapCapacity *= 2;
+
+    unsigned *vertexMap = calloc(mapCapacity, sizeof(unsigned));
+    unsigned *remap = malloc(sizeof(unsigned) * (vertexCount ? vertexCount : 1));
+    malloc_check(vertexMap);
+    malloc_check(remap);
+
+    int keptCount = 0;
+
+    for (int v = 0; v < vertexCount; ++v) {
+        uint64_t hash = hashBytes(HASH_SEED, vertices + v, sizeof(Vertex));
+        if (weights)
+            hash = hashBytes(hash, weights + v, sizeof(VertexWeight));
+
+        unsigned slot = (unsigned)hash & (mapCapacity - 1);
+
+        while (vertexMap[slot] && !vertexEqual(vertices, weights, vertexMap[slot] - 1, v))
+            slot = (slot + 1) & (mapCapacity - 1);
+
+        if (!vertexMap[slot]) {
+            vertices[keptCount] = vertices[v];
+            if (weights)
+                weights[keptCount] = weights[v];
+
+            vertexMap[slot] = ++keptCount;
+        }
+
+        remap[v] = vertexMap[slot] - 1;
+    }
+
+    for (int i = 0; i < indexCount; ++i)
+        indices[i] = remap[indices[i]];
+
+    free(remap);
+    free(vertexMap);
+
+    return keptCount;
+}
+
+
+static float vertexScore(int cachePosition, int remainingCount)
+{
+    if (!remainingCount)
+        return -1.0f;
+
+    float score = 0.0f;
+
+    /* NOTE: the last triangle's vertices get a fixed score so that it isn't
+     *       followed by one sharing just an edge with it all the time */
+    if (cachePosition >= 0 && cachePosition < 3) {
+        score = 0.75f;
+    } else if (cachePosition >= 3) {
+        float scaler = 1.0f / (MESH_SCORE_CACHE_SIZE - 3);
+        score = powf(1.0f - (cachePosition - 3) * scaler, 1.5f);
+    }
+
+    /* NOTE: vertices with few triangles left get them out of the way */
+    return score + 2.0f * powf((float)remainingCount, -0.5f);
+}
+
+
+void meshOptimizeVertexCache(unsigned *indices, int indexCount, int vertexCount)
+{
+    int triangleCount = indexCount / 3;
+    if (!triangleCount)
+        return;
+
+    int *remainingCounts  = calloc(vertexCount, sizeof(int));
+    int *triangleOffsets  = malloc(sizeof(int) * vertexCount);
+    int *cachePositions   = malloc(sizeof(int) * vertexCount);
+    float *vertexScores   = malloc(sizeof(float) * vertexCount);
+    int *vertexTriangles  = malloc(sizeof(int) * indexCount);
+    bool *emitted         = calloc(triangleCount, sizeof(bool));
+    unsigned *output      = malloc(sizeof(unsigned) * indexCount);
+
+    malloc_check(remainingCounts);
+    malloc_check(triangleOffsets);
+    malloc_check(cachePositions);
+    malloc_check(vertexScores);
+    malloc_check(vertexTriangles);
+    malloc_check(emitted);
+    malloc_check(output);
+
+    for (int i = 0; i < indexCount; ++i)
+        ++remainingCounts[indices[i]];
+
+    int offset = 0;
+    for (int v = 0; v < vertexCount; ++v) {
+        triangleOffsets[v] = offset;
+        offset += remainingCounts[v];
+        remainingCounts[v] = 0;
+    }
+
+    for (int i = 0; i < indexCount; ++i) {
+        unsigned v = indices[i];
+        vertexTriangles[triangleOffsets[v] + remainingCounts[v]++] = i / 3;
+    }
+
+    for (int v = 0; v < vertexCount; ++v) {
+        cachePositions[v] = -1;
+        vertexScores[v] = vertexScore(-1, remainingCounts[v]);
+    }
+
+    int bestTriangle = 0;
+    float bestScore = -1.0f;
+
+    for (int t = 0; t < triangleCount; ++t) {
+        float score = vertexScores[indices[3 * t]]
+                    + vertexScores[indices[3 * t + 1]]
+                    + vertexScores[indices[3 * t + 2]];
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestTriangle = t;
+        }
+    }
+
+    /* NOTE: 3 more to fit a triangle's worth of vertices before they're pushed out */
+    unsigned cache[MESH_SCORE_CACHE_SIZE + 3];
+    int cacheCount = 0;
+
+    int nextUnemitted = 0;
+
+    for (int outputCount = 0; outputCount < triangleCount; ++outputCount) {
+        /* NOTE: nothing in the cache has triangles left, take the first one that's left */
+        if (bestTriangle < 0) {
+            while (emitted[nextUnemitted])
+                ++nextUnemitted;
+            bestTriangle = nextUnemitted;
+        }
+
+        const unsigned *triangle = indices + 3 * bestTriangle;
+        memcpy(output + 3 * outputCount, triangle, sizeof(unsigned) * 3);
+        emitted[bestTriangle] = true;
+
+        /* NOTE: the triangle is done with, its vertices have one less to go */
+        for (int i = 0; i < 3; ++i) {
+            unsigned v = triangle[i];
+            int *triangles = vertexTriangles + triangleOffsets[v];
+
+            for (int j = 0; j < remainingCounts[v]; ++j) {
+                if (triangles[j] == bestTriangle) {
+                    triangles[j] = triangles[--remainingCounts[v]];
+                    break;
+                }
+            }
+        }
+
+        /* NOTE: LRU, the triangle's vertices move to the front */
+        unsigned newCache[MESH_SCORE_CACHE_SIZE + 3];
+        int newCount = 0;
+
+        for (int i = 0; i < 3; ++i)
+            newCache[newCount++] = triangle[i];
+
+        for (int i = 0; i < cacheCount; ++i) {
+            unsigned v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                newCache[newCount++] = v;
+        }
+
+        for (int i = 0; i < newCount; ++i) {
+            unsigned v = newCache[i];
+            cachePositions[v] = i < MESH_SCORE_CACHE_SIZE ? i : -1;
+            vertexScores[v] = vertexScore(cachePositions[v], remainingCounts[v]);
+        }
+
+        bestTriangle = -1;
+        bestScore = -1.0f;
+
+        for (int i = 0; i < newCount; ++i) {
+            unsigned v = newCache[i];
+            const int *triangles = vertexTriangles + triangleOffsets[v];
+
+            for (int j = 0; j < remainingCounts[v]; ++j) {
+                int t = triangles[j];
+
+                float score = vertexScores[indices[3 * t]]
+                            + vertexScores[indices[3 * t + 1]]
+                            + vertexScores[indices[3 * t + 2]];
+
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        cacheCount = newCount < MESH_SCORE_CACHE_SIZE ? newCount : MESH_SCORE_CACHE_SIZE;
+        memcpy(cache, newCache, sizeof(unsigned) * cacheCount);
+    }
+
+    memcpy(indices, output, sizeof(unsigned) * indexCount);
+
+    free(remainingCounts);
+    free(triangleOffsets);
+    free(cachePositions);
+    free(vertexScores);
+    free(vertexTriangles);
+    free(emitted);
+    free(output);
+}
+
+
+typedef struct
+{
+    int start;
+    int count;
+    float sortKey;
+} Cluster;
+
+
+static int compareClusters(const void *a, const void *b)
+{
+    const Cluster *c1 = a, *c2 = b;
+
+    if (c1->sortKey != c2->sortKey)
+        return c1->sortKey < c2->sortKey ? 1 : -1;
+
+    return c1->start - c2->start;
+}
+
+
+void meshOptimizeOverdraw(unsigned *indices, int indexCount, const Vertex *vertices, int vertexCount)
+{
+    int triangleCount = indexCount / 3;
+    if (!triangleCount)
+        return;
+
+    Cluster *clusters = malloc(sizeof(Cluster) * triangleCount);
+    malloc_check(clusters);
+
+    int clusterCount = 0;
+
+    /* NOTE: a cluster starts wherever none of a triangle's vertices are in the cache,
+     *       moving those around costs close to nothing */
+    unsigned cache[MESH_STATS_CACHE_SIZE];
+    int cacheCount = 0, cacheHead = 0;
+
+    for (int t = 0; t < triangleCount; ++t) {
+        int missCount = 0;
+
+        for (int i = 0; i < 3; ++i) {
+            unsigned v = indices[3 * t + i];
+            bool hit = false;
+
+            for (int j = 0; j < cacheCount && !hit; ++j)
+                hit = cache[j] == v;
+
+            if (hit)
+                continue;
+
+            ++missCount;
+            cache[cacheHead] = v;
+            cacheHead = (cacheHead + 1) % MESH_STATS_CACHE_SIZE;
+            if (cacheCount < MESH_STATS_CACHE_SIZE)
+                ++cacheCount;
+        }
+
+        if (missCount == 3 || !clusterCount)
+            clusters[clusterCount++] = (Cluster) { .start = t };
+
+        ++clusters[clusterCount - 1].count;
+    }
+
+    float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+    for (int v = 0; v < vertexCount; ++v)
+        for (int i = 0; i < 3; ++i)
+            meshCenter[i] += vertices[v].positions[i] / vertexCount;
+
+    for (int c = 0; c < clusterCount; ++c) {
+        float center[3] = { 0.0f, 0.0f, 0.0f };
+        float normal[3] = { 0.0f, 0.0f, 0.0f };
+        float area = 0.0f;
+
+        for (int t = clusters[c].start; t < clusters[c].start + clusters[c].count; ++t) {
+            const float *p0 = vertices[indices[3 * t]].positions;
+            const float *p1 = vertices[indices[3 * t + 1]].positions;
+            const float *p2 = vertices[indices[3 * t + 2]].positions;
+
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = {
+                e1[1] * e2[2] - e1[2] * e2[1],
+                e1[2] * e2[0] - e1[0] * e2[2],
+                e1[0] * e2[1] - e1[1] * e2[0],
+            };
+
+            /* NOTE: twice the area, it's only used as a weight */
+            float a = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int i = 0; i < 3; ++i) {
+                center[i] += (p0[i] + p1[i] + p2[i]) / 3.0f * a;
+                normal[i] += n[i];
+            }
+            area += a;
+        }
+
+        float normalLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+        clusters[c].sortKey = 0.0f;
+        if (area > 0.0f && normalLength > 0.0f) {
+            for (int i = 0; i < 3; ++i)
+                clusters[c].sortKey += (center[i] / area - meshCenter[i]) * normal[i] / normalLength;
+        }
+    }
+
+    qsort(clusters, clusterCount, sizeof(Cluster), compareClusters);
+
+    unsigned *output = malloc(sizeof(unsigned) * indexCount);
+    malloc_check(output);
+
+    int outputCount = 0;
+    for (int c = 0; c < clusterCount; ++c) {
+        memcpy(output + outputCount, indices + 3 * clusters[c].start, sizeof(unsigned) * 3 * clusters[c].count);
+        outputCount += 3 * clusters[c].count;
+    }
+
+    memcpy(indices, output, sizeof(unsigned) * indexCount);
+
+    free(output);
+    free(clusters);
+}
+
+
+void meshOptimizeVertexFetch(unsigned *indices, int indexCount, int vertexCount, unsigned *remap)
+{
+    const unsigned unused = (unsigned)-1;
+
+    for (int v = 0; v < vertexCount; ++v)
+        remap[v] = unused;
+
+    unsigned next = 0;
+
+    for (int i = 0; i < indexCount; ++i) {
+        if (remap[indices[i]] == unused)
+            remap[indices[i]] = next++;
+        indices[i] = remap[indices[i]];
+    }
+
+    /* NOTE: vertices no triangle uses keep their order at the end */
+    for (int v = 0; v < vertexCount; ++v)
+        if (remap[v] == unused)
+            remap[v] = next++;
+}
+
+
+void meshRemap(void *vertices, size_t size, int vertexCount, const unsigned *remap)
+{
+    uint8_t *copy = malloc(vertexCount ? size * vertexCount : 1);
+    malloc_check(copy);
+
+    memcpy(copy, vertices, size * vertexCount);
+
+    for (int v = 0; v < vertexCount; ++v)
+        memcpy((uint8_t *)vertices + size * remap[v], copy + size * v, size);
+
+    free(copy);
+}
+
+
+int meshOptimize(const char *name, unsigned *indices, int indexCount,
+                 Vertex *vertices, VertexWeight *weights, int vertexCount, bool overdraw)
+{
+    for (int i = 0; i < indexCount; ++i) {
+        if (indices[i] >= (unsigned)vertexCount) {
+            fprintf(stderr, "%s:%d: index out of range! name: \"%s\".\n", __FILE__, __LINE__, name);
+            exit(666);
+        }
+    }
+
+    MeshStats before = meshStats(indices, indexCount, vertexCount);
+    int weldedCount = meshWeld(indices, indexCount, vertices, weights, vertexCount);
+
+    meshOptimizeVertexCache(indices, indexCount, weldedCount);
+
+    if (overdraw)
+        meshOptimizeOverdraw(indices, indexCount, vertices, weldedCount);
+
+    unsigned *remap = malloc(sizeof(unsigned) * (weldedCount ? weldedCount : 1));
+    malloc_check(remap);
+
+    meshOptimizeVertexFetch(indices, indexCount, weldedCount, remap);
+    meshRemap(vertices, sizeof(Vertex), weldedCount, remap);
+    if (weights)
+        meshRemap(weights, sizeof(VertexWeight), weldedCount, remap);
+
+    free(remap);
+
+    MeshStats after = meshStats(indices, indexCount, weldedCount);
+
+    printf("%s: %d triangles, %d -> %d vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+           name, indexCount / 3, vertexCount, weldedCount, before.acmr, after.acmr, before.atvr, after.atvr);
+
+    return weldedCount;
+}
+
+
+/* NOTE: a symmetric 4x4 matrix of summed planes, weighted by the area they came from */
+typedef struct
+{
+    double a[10];
+    double weight;
+} Quadric;
+
+
+static void quadricAddPlane(Quadric *quadric, const double normal[3], double distance, double weight)
+{
+    double plane[4] = { normal[0], normal[1], normal[2], distance };
+
+    for (int i = 0, k = 0; i < 4; ++i)
+        for (int j = i; j < 4; ++j)
+            quadric->a[k++] += plane[i] * plane[j] * weight;
+
+    quadric->weight += weight;
+}
+
+
+static void quadricAdd(Quadric *quadric, const Quadric *other)
+{
+    for (int k = 0; k < 10; ++k)
+        quadric->a[k] += other->a[k];
+
+    quadric->weight += other->weight;
+}
+
+
+/* NOTE: the weighted mean of the squared distances to the planes */
+static double quadricError(const Quadric *quadric, const float position[3])
+{
+    double p[4] = { position[0], position[1], position[2], 1.0 };
+    double error = 0.0;
+
+    for (int i = 0, k = 0; i < 4; ++i)
+        for (int j = i; j < 4; ++j)
+            error += quadric->a[k++] * p[i] * p[j] * (i == j ? 1.0 : 2.0);
+
+    return quadric->weight > 0.0 ? fabs(error) / quadric->weight : 0.0;
+}
+
+
+/* NOTE: not normalised, twice the area long */
+static void triangleNormal(double normal[3], const float *p0, const float *p1, const float *p2)
+{
+    double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+
+static double length3(const double v[3])
+{
+    return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+
+/* NOTE: vertices with the same first `size` bytes get the same id, the position alone or
+ *       with the texture coordinates, `firstVertices` has the first vertex of every id */
+static int weldPrefixes(unsigned *ids, unsigned *firstVertices, const Vertex *vertices, int vertexCount, size_t size)
+{
+    unsigned mapCapacity = 1;
+    while (mapCapacity < 2 * (unsigned)vertexCount)
+        mapCapacity *= 2;
+
+    unsigned *idMap = calloc(mapCapacity, sizeof(unsigned));
+    malloc_check(idMap);
+
+    int idCount = 0;
+
+    for (int v = 0; v < vertexCount; ++v) {
+        unsigned slot = (unsigned)hashBytes(HASH_SEED, vertices + v, size) & (mapCapacity - 1);
+
+        while (idMap[slot] && memcmp(vertices + firstVertices[idMap[slot] - 1], vertices + v, size))
+            slot = (slot + 1) & (mapCapacity - 1);
+
+        if (!idMap[slot]) {
+            firstVertices[idCount] = v;
+            idMap[slot] = ++idCount;
+        }
+
+        ids[v] = idMap[slot] - 1;
+    }
+
+    free(idMap);
+
+    return idCount;
+}
+
+
+/* NOTE: open addressing over the ids' `from << 32 | to`, a slot holds the key plus one */
+static uint64_t *buildEdgeSet(const unsigned *indices, int indexCount, const unsigned *ids, unsigned *capacity)
+{
+    *capacity = 1;
+    while (*capacity < 2 * (unsigned)indexCount)
+        *capacity *= 2;
+
+    uint64_t *edges = calloc(*capacity, sizeof(uint64_t));
+    malloc_check(edges);
+
+    for (int i = 0; i < indexCount; ++i) {
+        uint64_t key = (uint64_t)ids[indices[i]] << 32 | ids[indices[i - i % 3 + (i + 1) % 3]];
+        unsigned slot = (unsigned)hashBytes(HASH_SEED, &key, sizeof(key)) & (*capacity - 1);
+
+        while (edges[slot] && edges[slot] != key + 1)
+            slot = (slot + 1) & (*capacity - 1);
+
+        edges[slot] = key + 1;
+    }
+
+    return edges;
+}
+
+
+static bool edgeSetHas(const uint64_t *edges, unsigned capacity, unsigned from, unsigned to)
+{
+    uint64_t key = (uint64_t)from << 32 | to;
+    unsigned slot = (unsigned)hashBytes(HASH_SEED, &key, sizeof(key)) & (capacity - 1);
+
+    while (edges[slot]) {
+        if (edges[slot] == key + 1)
+            return true;
+        slot = (slot + 1) & (capacity - 1);
+    }
+
+    return false;
+}
+
+
+typedef struct
+{
+    unsigned from;
+    unsigned to;
+    double error;
+} Collapse;
+
+
+static int compareCollapses(const void *a, const void *b)
+{
+    const Collapse *c1 = a, *c2 = b;
+
+    if (c1->error != c2->error)
+        return c1->error < c2->error ? -1 : 1;
+    if (c1->from != c2->from)
+        return c1->from < c2->from ? -1 : 1;
+
+    return (c1->to > c2->to) - (c1->to < c2->to);
+}
+
+
+int meshSimplify(unsigned *output, const unsigned *indices, int indexCount,
+                 const Vertex *vertices, int vertexCount, int targetIndexCount, float *error)
+{
+    const unsigned unused = (unsigned)-1;
+
+    memcpy(output, indices, sizeof(unsigned) * indexCount);
+    *error = 0.0f;
+
+    if (indexCount <= targetIndexCount)
+        return indexCount;
+
+    unsigned *positionIds      = malloc(sizeof(unsigned) * vertexCount);
+    unsigned *positionVertices = malloc(sizeof(unsigned) * vertexCount);
+    unsigned *wedgeIds         = malloc(sizeof(unsigned) * vertexCount);
+    unsigned *wedgeVertices    = malloc(sizeof(unsigned) * vertexCount);
+    malloc_check(positionIds);
+    malloc_check(positionVertices);
+    malloc_check(wedgeIds);
+    malloc_check(wedgeVertices);
+
+    /* NOTE: normals are left out of the wedges, they'd make every edge of a flat shaded
+     *       mesh a seam, the ones kept are a bit off from the new faces but it's far away */
+    int positionCount = weldPrefixes(positionIds, positionVertices, vertices, vertexCount, sizeof(float) * 3);
+    weldPrefixes(wedgeIds, wedgeVertices, vertices, vertexCount, sizeof(float) * 5);
+
+    Quadric *quadrics = calloc(positionCount, sizeof(Quadric));
+    malloc_check(quadrics);
+
+    unsigned edgeCapacity;
+    uint64_t *edges = buildEdgeSet(indices, indexCount, wedgeIds, &edgeCapacity);
+
+    for (int t = 0; t < indexCount / 3; ++t) {
+        const unsigned *triangle = indices + 3 * t;
+
+        double normal[3];
+        triangleNormal(normal, vertices[triangle[0]].positions, vertices[triangle[1]].positions,
+                       vertices[triangle[2]].positions);
+
+        double length = length3(normal);
+        if (length == 0.0)
+            continue;
+
+        for (int i = 0; i < 3; ++i)
+            normal[i] /= length;
+
+        const float *p0 = vertices[triangle[0]].positions;
+        double distance = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+
+        for (int i = 0; i < 3; ++i)
+            quadricAddPlane(quadrics + positionIds[triangle[i]], normal, distance, length * 0.5);
+
+        /* NOTE: an edge nothing goes back along is a border or a seam, a plane through it
+         *       standing on the triangle keeps its outline from wandering off */
+        for (int i = 0; i < 3; ++i) {
+            unsigned a = triangle[i], b = triangle[(i + 1) % 3];
+
+            if (edgeSetHas(edges, edgeCapacity, wedgeIds[b], wedgeIds[a]))
+                continue;
+
+            const float *pa = vertices[a].positions, *pb = vertices[b].positions;
+            double edge[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+            double side[3] = {
+                edge[1] * normal[2] - edge[2] * normal[1],
+                edge[2] * normal[0] - edge[0] * normal[2],
+                edge[0] * normal[1] - edge[1] * normal[0],
+            };
+
+            double sideLength = length3(side);
+            if (sideLength == 0.0)
+                continue;
+
+            for (int j = 0; j < 3; ++j)
+                side[j] /= sideLength;
+
+            double sideDistance = -(side[0] * pa[0] + side[1] * pa[1] + side[2] * pa[2]);
+            double weight = (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]) * MESH_BORDER_WEIGHT;
+
+            quadricAddPlane(quadrics + positionIds[a], side, sideDistance, weight);
+            quadricAddPlane(quadrics + positionIds[b], side, sideDistance, weight);
+        }
+    }
+
+    free(edges);
+
+    int *fanOffsets        = malloc(sizeof(int) * (positionCount + 1));
+    int *fanTriangles      = malloc(sizeof(int) * indexCount);
+    bool *locked           = malloc(sizeof(bool) * positionCount);
+    unsigned *remap        = malloc(sizeof(unsigned) * vertexCount);
+    unsigned *wedgeTargets = malloc(sizeof(unsigned) * vertexCount);
+    Collapse *collapses    = malloc(sizeof(Collapse) * 2 * indexCount);
+
+    malloc_check(fanOffsets);
+    malloc_check(fanTriangles);
+    malloc_check(locked);
+    malloc_check(remap);
+    malloc_check(wedgeTargets);
+    malloc_check(collapses);
+
+    for (int v = 0; v < vertexCount; ++v)
+        wedgeTargets[v] = unused;
+
+    double maxError = 0.0;
+
+    /* NOTE: every pass takes the cheapest collapses that don't touch each other's
+     *       triangles, until the target is reached or nothing can go */
+    while (indexCount > targetIndexCount) {
+        memset(fanOffsets, 0, sizeof(int) * (positionCount + 1));
+        for (int i = 0; i < indexCount; ++i)
+            ++fanOffsets[positionIds[output[i]] + 1];
+        for (int p = 0; p < positionCount; ++p)
+            fanOffsets[p + 1] += fanOffsets[p];
+        for (int i = 0; i < indexCount; ++i)
+            fanTriangles[fanOffsets[positionIds[output[i]]]++] = i / 3;
+        for (int p = positionCount; p > 0; --p)
+            fanOffsets[p] = fanOffsets[p - 1];
+        fanOffsets[0] = 0;
+
+        int collapseCount = 0;
+
+        for (int i = 0; i < indexCount; ++i) {
+            unsigned a = output[i], b = output[i - i % 3 + (i + 1) % 3];
+            unsigned pa = positionIds[a], pb = positionIds[b];
+
+            if (pa == pb)
+                continue;
+
+            collapses[collapseCount++] = (Collapse) { pa, pb, quadricError(quadrics + pa, vertices[b].positions) };
+            collapses[collapseCount++] = (Collapse) { pb, pa, quadricError(quadrics + pb, vertices[a].positions) };
+        }
+
+        qsort(collapses, collapseCount, sizeof(Collapse), compareCollapses);
+
+        memset(locked, 0, sizeof(bool) * positionCount);
+        for (int v = 0; v < vertexCount; ++v)
+            remap[v] = v;
+
+        int removeCount = (indexCount - targetIndexCount + 2) / 3;
+        int removedCount = 0;
+        int collapsedCount = 0;
+
+        for (int c = 0; c < collapseCount && removedCount < removeCount; ++c) {
+            unsigned from = collapses[c].from, to = collapses[c].to;
+
+            if (locked[from] || locked[to])
+                continue;
+
+            const float *target = vertices[positionVertices[to]].positions;
+            bool allowed = true;
+            int sharedCount = 0;
+
+            /* NOTE: every corner at `from` needs exactly one corner at `to` to become,
+             *       so seams only fold along themselves, and nothing may flip over */
+            for (int f = fanOffsets[from]; f < fanOffsets[from + 1]; ++f) {
+                const unsigned *triangle = output + 3 * fanTriangles[f];
+                int corner = 0, shared = -1;
+
+                for (int i = 0; i < 3; ++i) {
+                    if (positionIds[triangle[i]] == from)
+                        corner = i;
+                    else if (positionIds[triangle[i]] == to)
+                        shared = i;
+                }
+
+                unsigned wedge = wedgeIds[triangle[corner]];
+
+                if (shared >= 0) {
+                    ++sharedCount;
+                    if (wedgeTargets[wedge] == unused)
+                        wedgeTargets[wedge] = triangle[shared];
+                    else if (wedgeIds[wedgeTargets[wedge]] != wedgeIds[triangle[shared]])
+                        allowed = false;
+                    continue;
+                }
+
+                const float *p[3];
+                for (int i = 0; i < 3; ++i)
+                    p[i] = vertices[triangle[i]].positions;
+
+                double before[3], after[3];
+                triangleNormal(before, p[0], p[1], p[2]);
+                p[corner] = target;
+                triangleNormal(after, p[0], p[1], p[2]);
+
+                double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                if (dot <= MESH_FLIP_COSINE * length3(before) * length3(after))
+                    allowed = false;
+            }
+
+            for (int f = fanOffsets[from]; f < fanOffsets[from + 1]; ++f) {
+                const unsigned *triangle = output + 3 * fanTriangles[f];
+
+                for (int i = 0; i < 3; ++i) {
+                    if (positionIds[triangle[i]] != from)
+                        continue;
+
+                    unsigned target = wedgeTargets[wedgeIds[triangle[i]]];
+
+                    if (target == unused)
+                        allowed = false;
+                    else if (allowed)
+                        remap[triangle[i]] = target;
+                }
+            }
+
+            for (int f = fanOffsets[from]; f < fanOffsets[from + 1]; ++f)
+                for (int i = 0; i < 3; ++i)
+                    wedgeTargets[wedgeIds[output[3 * fanTriangles[f] + i]]] = unused;
+
+            if (!allowed || !sharedCount)
+                continue;
+
+            for (int f = fanOffsets[from]; f < fanOffsets[from + 1]; ++f)
+                for (int i = 0; i < 3; ++i)
+                    locked[positionIds[output[3 * fanTriangles[f] + i]]] = true;
+
+            quadricAdd(quadrics + to, quadrics + from);
+
+            if (collapses[c].error > maxError)
+                maxError = collapses[c].error;
+
+            removedCount += sharedCount;
+            ++collapsedCount;
+        }
+
+        if (!collapsedCount)
+            break;
+
+        int keptCount = 0;
+
+        for (int t = 0; t < indexCount / 3; ++t) {
+            unsigned a = remap[output[3 * t]], b = remap[output[3 * t + 1]], c = remap[output[3 * t + 2]];
+            unsigned pa = positionIds[a], pb = positionIds[b], pc = positionIds[c];
+
+            if (pa == pb || pb == pc || pc == pa)
+                continue;
+
+            output[keptCount++] = a;
+            output[keptCount++] = b;
+            output[keptCount++] = c;
+        }
+
+        indexCount = keptCount;
+    }
+
+    free(collapses);
+    free(wedgeTargets);
+    free(remap);
+    free(locked);
+    free(fanTriangles);
+    free(fanOffsets);
+    free(quadrics);
+    free(wedgeVertices);
+    free(wedgeIds);
+    free(positionVertices);
+    free(positionIds);
+
+    *error = (float)sqrt(maxError);
+
+    return indexCount;
+}
+
+
+int meshBuildLods(MeshLod *lods, int maxLodCount, const unsigned *indices, int indexCount,
+                  const Vertex *vertices, int vertexCount)
+{
+    int lodCount = 0;
+    int previousCount = indexCount;
+
+    while (lodCount < maxLodCount) {
+        unsigned *lodIndices = malloc(sizeof(unsigned) * (indexCount ? indexCount : 1));
+        malloc_check(lodIndices);
+
+        /* NOTE: always from the full mesh, so the error is against what it replaces */
+        float error;
+        int lodIndexCount = meshSimplify(lodIndices, indices, indexCount, vertices, vertexCount,
+                                         previousCount / 6 * 3, &error);
+
+        /* NOTE: stuck on seams and borders, a level this close to the last isn't worth it */
+        if (lodIndexCount > previousCount * MESH_LOD_MIN_REDUCTION) {
+            free(lodIndices);
+            break;
+        }
+
+        meshOptimizeVertexCache(lodIndices, lodIndexCount, vertexCount);
+
+        lods[lodCount++] = (MeshLod) { lodIndices, lodIndexCount, error };
+        previousCount = lodIndexCount;
+    }
+
+    return lodCount;
+}
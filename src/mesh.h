@@ -0,0 +1,67 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "res.h"
+
+#include <stdbool.h>
+
+/* NOTE: what the triangle order is scored against, and the FIFO the stats simulate */
+#define MESH_SCORE_CACHE_SIZE 32
+#define MESH_STATS_CACHE_SIZE 16
+
+typedef struct
+{
+    /* NOTE: cache misses per triangle, 0.5 at best, 3 at worst */
+    float acmr;
+    /* NOTE: cache misses per vertex, 1 at best */
+    float atvr;
+} MeshStats;
+
+
+MeshStats meshStats(const unsigned *indices, int indexCount, int vertexCount);
+
+/* NOTE: merges vertices with the same bytes, returns how many are left at the front */
+int meshWeld(unsigned *indices, int indexCount, Vertex *vertices, VertexWeight *weights, int vertexCount);
+
+/* NOTE: Forsyth's linear-speed vertex cache optimisation, reorders triangles only */
+void meshOptimizeVertexCache(unsigned *indices, int indexCount, int vertexCount);
+
+/* NOTE: splits the triangles where the cache starts over and puts the clusters facing
+ *       away from the middle first, so they tend to be drawn before what they cover */
+void meshOptimizeOverdraw(unsigned *indices, int indexCount, const Vertex *vertices, int vertexCount);
+
+/* NOTE: `remap[old] = new`, vertices in the order the indices first use them */
+void meshOptimizeVertexFetch(unsigned *indices, int indexCount, int vertexCount, unsigned *remap);
+void meshRemap(void *vertices, size_t size, int vertexCount, const unsigned *remap);
+
+/* NOTE: all of the above in order, `weights` may be NULL, prints the stats under `name`
+ *       and returns the vertex count after welding */
+int meshOptimize(const char *name, unsigned *indices, int indexCount,
+                 Vertex *vertices, VertexWeight *weights, int vertexCount, bool overdraw);
+
+/* NOTE: how much more a border or seam plane counts than the faces next to it, the cosine
+ *       a face may turn by in a collapse, and what a LOD has to get down to to be kept */
+#define MESH_BORDER_WEIGHT     10.0
+#define MESH_FLIP_COSINE       0.25
+#define MESH_LOD_MIN_REDUCTION 0.8
+
+typedef struct
+{
+    unsigned *indices;
+    int indexCount;
+    /* NOTE: in model units, roughly how far the surface moved at worst */
+    float error;
+} MeshLod;
+
+
+/* NOTE: quadric error edge collapses onto existing vertices, so the result indexes the
+ *       same vertex buffer, stops early when nothing more can go without breaking a seam */
+int meshSimplify(unsigned *output, const unsigned *indices, int indexCount,
+                 const Vertex *vertices, int vertexCount, int targetIndexCount, float *error);
+
+/* NOTE: up to `maxLodCount` levels with about half the triangles of the one before,
+ *       cache optimised, returns how many there are and the caller frees their indices */
+int meshBuildLods(MeshLod *lods, int maxLodCount, const unsigned *indices, int indexCount,
+                  const Vertex *vertices, int vertexCount);
+
+#endif
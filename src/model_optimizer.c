@@ -0,0 +1,176 @@
+#include "mesh.h"
+
+#include "pack.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* usage: model_optimizer [--overdraw] [--lods] <files...>
+ *
+ * NOTE: rewrites .model files from obj_parser and .animated files from dae_parser.py
+ *       in place, only duplicate vertices go and the order of the rest changes:
+ *       ./model_optimizer $(find res -name '*.model' -o -name '*.animated')
+ *
+ *       --lods appends simplified levels to .model files for the static renderer:
+ *       ./model_optimizer --lods res/tree.model res/bush.model res/rock.model
+ *       files that have them get them rebuilt, they index the vertices from before */
+
+
+static int readInt(const uint8_t *data, size_t size, size_t *offset, const char *path)
+{
+    int value;
+
+    if (size - *offset < sizeof(int)) {
+        fprintf(stderr, "%s:%d: read past the end! path: \"%s\".\n", __FILE__, __LINE__, path);
+        exit(666);
+    }
+
+    memcpy(&value, data + *offset, sizeof(int));
+    *offset += sizeof(int);
+
+    return value;
+}
+
+
+static void optimizeFile(const char *path, bool overdraw, bool lods)
+{
+    Asset asset = assetLoad(path);
+
+    uint8_t *data = malloc(asset.size ? asset.size : 1);
+    malloc_check(data);
+    memcpy(data, asset.data, asset.size);
+
+    size_t size = asset.size;
+    assetFree(asset);
+
+    const char *extension = strrchr(path, '.');
+    bool animated = extension && !strcmp(extension, ".animated");
+
+    bool compressed = animated && size >= 4 && !memcmp(data, ANIMATED_COMPRESSED_MAGIC, 4);
+    size_t offset = compressed ? 4 : 0;
+
+    size_t countOffset = offset;
+    int vertexCount = readInt(data, size, &offset, path);
+    int indexCount  = readInt(data, size, &offset, path);
+
+    /* NOTE: the bone count, and the frame and key counts of compressed files */
+    if (animated)
+        readInt(data, size, &offset, path);
+
+    if (compressed) {
+        readInt(data, size, &offset, path);
+        readInt(data, size, &offset, path);
+        readInt(data, size, &offset, path);
+    }
+
+    size_t meshSize = sizeof(Vertex) * (size_t)vertexCount + sizeof(unsigned) * (size_t)indexCount
+                    + (animated ? sizeof(VertexWeight) * (size_t)vertexCount : 0);
+
+    if (vertexCount < 0 || indexCount < 0 || indexCount % 3 || size - offset < meshSize) {
+        fprintf(stderr, "%s:%d: not a model! path: \"%s\".\n", __FILE__, __LINE__, path);
+        exit(666);
+    }
+
+    /* NOTE: nothing but old LODs after a static model */
+    bool hadLods = !animated && size - offset != meshSize;
+
+    if (hadLods && (size - offset - meshSize < 4 || memcmp(data + offset + meshSize, MODEL_LODS_MAGIC, 4))) {
+        fprintf(stderr, "%s:%d: not a model! path: \"%s\".\n", __FILE__, __LINE__, path);
+        exit(666);
+    }
+
+    /* NOTE: the data is only 4 byte aligned after the magic, copies keep it simple */
+    Vertex *vertices = malloc(sizeof(Vertex) * (vertexCount ? vertexCount : 1));
+    unsigned *indices = malloc(sizeof(unsigned) * (indexCount ? indexCount : 1));
+    VertexWeight *weights = animated ? malloc(sizeof(VertexWeight) * (vertexCount ? vertexCount : 1)) : NULL;
+    malloc_check(vertices);
+    malloc_check(indices);
+    if (animated)
+        malloc_check(weights);
+
+    const uint8_t *vertexData = data + offset;
+    const uint8_t *indexData  = vertexData + sizeof(Vertex) * vertexCount;
+    const uint8_t *weightData = indexData + sizeof(unsigned) * indexCount;
+
+    memcpy(vertices, vertexData, sizeof(Vertex) * vertexCount);
+    memcpy(indices, indexData, sizeof(unsigned) * indexCount);
+    if (animated)
+        memcpy(weights, weightData, sizeof(VertexWeight) * vertexCount);
+
+    int weldedCount = meshOptimize(path, indices, indexCount, vertices, weights, vertexCount, overdraw);
+    memcpy(data + countOffset, &weldedCount, sizeof(int));
+
+    MeshLod meshLods[MAX_MODEL_LOD_COUNT];
+    int lodCount = 0;
+
+    if ((lods || hadLods) && !animated)
+        lodCount = meshBuildLods(meshLods, MAX_MODEL_LOD_COUNT, indices, indexCount, vertices, weldedCount);
+
+    for (int i = 0; i < lodCount; ++i)
+        printf("%s: LOD %d, %d triangles, error %g\n", path, i + 1, meshLods[i].indexCount / 3, meshLods[i].error);
+
+    /* NOTE: the armature after the mesh is left as it was */
+    const uint8_t *rest = data + offset + meshSize;
+    size_t restSize = animated ? size - offset - meshSize : 0;
+
+    FILE *out = fopen(path, "wb");
+    file_check(out, path);
+
+    safe_write(data, 1, offset, out);
+    safe_write(vertices, sizeof(Vertex), weldedCount, out);
+    safe_write(indices, sizeof(unsigned), indexCount, out);
+    if (animated)
+        safe_write(weights, sizeof(VertexWeight), weldedCount, out);
+    safe_write(rest, 1, restSize, out);
+
+    if (lodCount) {
+        safe_write(MODEL_LODS_MAGIC, 1, 4, out);
+        safe_write(&lodCount, sizeof(int), 1, out);
+
+        for (int i = 0; i < lodCount; ++i) {
+            ModelLod lod = { meshLods[i].indexCount, meshLods[i].error };
+            safe_write(&lod, sizeof(ModelLod), 1, out);
+        }
+
+        for (int i = 0; i < lodCount; ++i) {
+            safe_write(meshLods[i].indices, sizeof(unsigned), meshLods[i].indexCount, out);
+            free(meshLods[i].indices);
+        }
+    }
+
+    fclose(out);
+
+    free(weights);
+    free(indices);
+    free(vertices);
+    free(data);
+}
+
+
+int main(int argc, char *argv[])
+{
+    bool overdraw = false;
+    bool lods = false;
+    int first = 1;
+
+    for (; first < argc && !strncmp(argv[first], "--", 2); ++first) {
+        if (!strcmp(argv[first], "--overdraw"))
+            overdraw = true;
+        else if (!strcmp(argv[first], "--lods"))
+            lods = true;
+        else
+            break;
+    }
+
+    if (argc <= first || !strncmp(argv[first], "--", 2)) {
+        fprintf(stderr, "usage: %s [--overdraw] [--lods] <files...>\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = first; i < argc; ++i)
+        optimizeFile(argv[i], overdraw, lods);
+
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "utils.h"
+#include "mesh.h"
 
 #include <stdbool.h>
 #include <string.h>
@@ -57,14 +58,6 @@ typedef struct
 } Index;
 
 
-typedef struct
-{
-    float positions[3];
-    float textures[2];
-    float normals[3];
-} Vertex;
-
-
 static bool indexEq(const Index *i1, const Index *i2)
 {
     return i1->posID  == i2->posID
@@ -73,7 +66,14 @@ static bool indexEq(const Index *i1, const Index *i2)
 }
 
 
-static void parse(const ObjInfo *info, const char *text, FILE *out)
+static unsigned indexHash(const Index *index)
+{
+    int ids[3] = { index->posID, index->texID, index->normID };
+    return (unsigned)hashBytes(HASH_SEED, ids, sizeof(ids));
+}
+
+
+static void parse(const ObjInfo *info, const char *text, FILE *out, const char *name, bool overdraw)
 {
     float *positions, *textures, *normals;
 
@@ -94,6 +94,14 @@ static void parse(const ObjInfo *info, const char *text, FILE *out)
     unsigned *indexData = malloc(sizeof(unsigned) * info->indexCount);
     malloc_check(indexData);
 
+    /* NOTE: open addressing, a slot holds the vertex plus one, 0 when empty */
+    unsigned mapCapacity = 1;
+    while (mapCapacity < 2 * (unsigned)info->indexCount)
+        mapCapacity *= 2;
+
+    int *vertexMap = calloc(mapCapacity, sizeof(int));
+    malloc_check(vertexMap);
+
     int posOffset  = 0;
     int texOffset  = 0;
     int normOffset = 0;
@@ -148,18 +156,14 @@ static void parse(const ObjInfo *info, const char *text, FILE *out)
 
                 if (++ic == 3) {
                     for (int i = 0; i < 3; ++i) {
-                        bool found = false;
-
-                        // TODO heap search
-                        for (int j = 0; j < vertexCount; ++j) {
-                            if (indexEq(inds + i, indices + j)) {
-                                indexData[indexCount++] = indices[j].index;
-                                found = true;
-                                break;
-                            }
-                        }
+                        unsigned slot = indexHash(inds + i) & (mapCapacity - 1);
 
-                        if (!found) {
+                        while (vertexMap[slot] && !indexEq(inds + i, indices + vertexMap[slot] - 1))
+                            slot = (slot + 1) & (mapCapacity - 1);
+
+                        if (vertexMap[slot]) {
+                            indexData[indexCount++] = indices[vertexMap[slot] - 1].index;
+                        } else {
                             Vertex vert;
                             int offset = 3 * inds[i].posID;
                             vert.positions[0] = positions[offset];
@@ -183,6 +187,7 @@ static void parse(const ObjInfo *info, const char *text, FILE *out)
                             };
 
                             indices[vertexCount] = ind;
+                            vertexMap[slot] = vertexCount + 1;
 
                             indexData[indexCount++] = vertexCount++;
                         }
@@ -194,6 +199,8 @@ static void parse(const ObjInfo *info, const char *text, FILE *out)
         }
     }
 
+    vertexCount = meshOptimize(name, indexData, indexCount, vertices, NULL, vertexCount, overdraw);
+
     // TODO FIXME write failure handling
     safe_write(&vertexCount, sizeof(int), 1, out);
     safe_write(&indexCount, sizeof(int), 1, out);
@@ -207,13 +214,16 @@ static void parse(const ObjInfo *info, const char *text, FILE *out)
     free(indices);
     free(vertices);
     free(indexData);
+    free(vertexMap);
 }
 
 
 int main(int argc, char *argv[])
 {
-    if (argc != 3) {
-        fprintf(stderr, "use: obj_parser <input-file> <output-file>\n");
+    bool overdraw = argc == 4 && !strcmp(argv[3], "--overdraw");
+
+    if (argc != 3 && !overdraw) {
+        fprintf(stderr, "use: obj_parser <input-file> <output-file> [--overdraw]\n");
         exit(1);
     }
 
@@ -224,7 +234,7 @@ int main(int argc, char *argv[])
     FILE *out = fopen(argv[2], "wb");
     file_check(out, argv[2]);
 
-    parse(&info, text, out);
+    parse(&info, text, out, argv[1], overdraw);
 
     fclose(out);
     free(text);
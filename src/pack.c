@@ -0,0 +1,212 @@
+#include "pack.h"
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+
+static const uint8_t   *packData;
+static size_t           packSize;
+static const PackEntry *packEntries;
+static uint32_t         packEntryCount;
+
+
+static void packError(const char *path, const char *reason)
+{
+    fprintf(stderr, "%s:%d: broken asset pack! %s. path: \"%s\".\n", __FILE__, __LINE__, reason, path);
+    exit(666);
+}
+
+
+/* NOTE: NULL when the file can't be opened, the mapping outlives the handles */
+static const uint8_t *mapFile(const char *path, size_t *size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+        return NULL;
+
+    const uint8_t *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+
+    *size = (size_t)fileSize.QuadPart;
+    return data;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+        return NULL;
+
+    struct stat info;
+    if (fstat(file, &info) || info.st_size == 0) {
+        close(file);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    /* NOTE: all of it gets read during startup, might as well start now */
+    posix_madvise(data, (size_t)info.st_size, POSIX_MADV_WILLNEED);
+
+    *size = (size_t)info.st_size;
+    return data;
+#endif
+}
+
+
+static void unmapFile(const uint8_t *data, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, size);
+#endif
+}
+
+
+bool packOpen(const char *path)
+{
+    packClose();
+
+    size_t size;
+    const uint8_t *data = mapFile(path, &size);
+    if (!data)
+        return false;
+
+    PackHeader header;
+    if (size < sizeof(header))
+        packError(path, "Too short");
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.magic, PACK_MAGIC, 4))
+        packError(path, "Wrong format");
+    if (header.version != PACK_VERSION)
+        packError(path, "Wrong version, rebuild it with pack_builder");
+    if (header.entryCount > (size - sizeof(header)) / sizeof(PackEntry))
+        packError(path, "Table of contents past the end of the file");
+
+    const PackEntry *entries = (const PackEntry *)(data + sizeof(header));
+
+    for (uint32_t i = 0; i < header.entryCount; ++i) {
+        if (entries[i].offset % PACK_ALIGNMENT || entries[i].offset > size
+         || entries[i].size > size - entries[i].offset)
+            packError(path, "Entry past the end of the file");
+        if (entries[i].path[PACK_PATH_SIZE - 1])
+            packError(path, "Unterminated entry path");
+        if (i && strcmp(entries[i - 1].path, entries[i].path) >= 0)
+            packError(path, "Unsorted table of contents");
+    }
+
+    packData       = data;
+    packSize       = size;
+    packEntries    = entries;
+    packEntryCount = header.entryCount;
+
+    return true;
+}
+
+
+void packClose(void)
+{
+    if (packData)
+        unmapFile(packData, packSize);
+
+    packData       = NULL;
+    packSize       = 0;
+    packEntries    = NULL;
+    packEntryCount = 0;
+}
+
+
+static int compareEntry(const void *path, const void *entry)
+{
+    return strncmp(path, ((const PackEntry *)entry)->path, PACK_PATH_SIZE);
+}
+
+
+const PackEntry *packFind(const char *path)
+{
+    if (!packEntries)
+        return NULL;
+
+    return bsearch(path, packEntries, packEntryCount, sizeof(PackEntry), compareEntry);
+}
+
+
+bool assetTryLoad(const char *path, Asset *asset)
+{
+    const PackEntry *entry = packFind(path);
+    if (entry) {
+        *asset = (Asset) { packData + entry->offset, (size_t)entry->size, NULL };
+        return true;
+    }
+
+    /* NOTE: one read straight into a block the caller frees through assetFree */
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size < 0) {
+        fprintf(stderr, "%s:%d: ftell failure! path: \"%s\".\n", __FILE__, __LINE__, path);
+        exit(666);
+    }
+
+    uint8_t *block = malloc(size ? (size_t)size : 1);
+    malloc_check(block);
+    safe_read(block, 1, (size_t)size, file);
+
+    fclose(file);
+
+    *asset = (Asset) { block, (size_t)size, block };
+    return true;
+}
+
+
+Asset assetLoad(const char *path)
+{
+    Asset asset;
+
+    if (!assetTryLoad(path, &asset)) {
+        fprintf(stderr, "%s:%d: fopen failure! path: \"%s\".\n", __FILE__, __LINE__, path);
+        exit(666);
+    }
+
+    return asset;
+}
+
+
+void assetFree(Asset asset)
+{
+    free(asset.block);
+}
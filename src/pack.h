@@ -0,0 +1,60 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/* NOTE: a header, a table of contents sorted by path and then the files as
+ *       they are on disk, each starting on a PACK_ALIGNMENT boundary */
+#define PACK_MAGIC     "BRPK"
+#define PACK_VERSION   1
+#define PACK_ALIGNMENT 64
+#define PACK_PATH_SIZE 48
+
+/* looked for in the working directory, loose files are used without it */
+#define PACK_FILE "res.pack"
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+} PackHeader;
+
+typedef struct
+{
+    /* NOTE: as the game asks for it, "res/tree.model", zero padded */
+    char path[PACK_PATH_SIZE];
+    uint64_t offset;
+    uint64_t size;
+} PackEntry;
+
+static_assert(sizeof(PackHeader) == 16, "PackHeader has to be tightly packed");
+static_assert(sizeof(PackEntry) == 64, "PackEntry has to be tightly packed");
+
+
+/* NOTE: `data` points into the pack, or into `block` for loose files */
+typedef struct
+{
+    const uint8_t *data;
+    size_t size;
+    void *block;
+} Asset;
+
+
+/* NOTE: maps the whole pack once, false when there is none */
+bool packOpen(const char *path);
+void packClose(void);
+
+const PackEntry *packFind(const char *path);
+
+/* NOTE: from the pack when it has it, read whole from disk otherwise */
+Asset assetLoad(const char *path);
+/* NOTE: false instead of exiting when there is no such file */
+bool assetTryLoad(const char *path, Asset *asset);
+void assetFree(Asset asset);
+
+#endif
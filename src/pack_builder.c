@@ -0,0 +1,127 @@
+#include "pack.h"
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* usage: pack_builder <pack> <files...>
+ *
+ * NOTE: run from the game directory so that the paths match what the game asks for:
+ *       ./pack_builder res.pack $(find res shaders -type f) */
+
+
+static int comparePaths(const void *a, const void *b)
+{
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+}
+
+
+static long fileSize(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    file_check(file, path);
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+
+    if (size < 0) {
+        fprintf(stderr, "%s:%d: ftell failure! path: \"%s\".\n", __FILE__, __LINE__, path);
+        exit(666);
+    }
+
+    return size;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <pack> <files...>\n", argv[0]);
+        return 1;
+    }
+
+    int count = argc - 2;
+    char **paths = argv + 2;
+
+    /* NOTE: the game looks them up with forward slashes */
+    for (int i = 0; i < count; ++i) {
+        for (char *c = paths[i]; *c; ++c)
+            if (*c == '\\')
+                *c = '/';
+
+        if (strlen(paths[i]) >= PACK_PATH_SIZE) {
+            fprintf(stderr, "path longer than %d characters: \"%s\"\n", PACK_PATH_SIZE - 1, paths[i]);
+            return 1;
+        }
+    }
+
+    qsort(paths, count, sizeof(char *), comparePaths);
+
+    PackEntry *entries = calloc(count, sizeof(PackEntry));
+    malloc_check(entries);
+
+    uint64_t offset = alignOffset(sizeof(PackHeader) + sizeof(PackEntry) * count);
+    size_t largest = 1;
+
+    for (int i = 0; i < count; ++i) {
+        if (i && !strcmp(paths[i - 1], paths[i])) {
+            fprintf(stderr, "duplicate path: \"%s\"\n", paths[i]);
+            return 1;
+        }
+
+        strcpy(entries[i].path, paths[i]);
+        entries[i].offset = offset;
+        entries[i].size   = (uint64_t)fileSize(paths[i]);
+
+        if (entries[i].size > largest)
+            largest = (size_t)entries[i].size;
+
+        offset = alignOffset(offset + entries[i].size);
+    }
+
+    FILE *out = fopen(argv[1], "wb");
+    file_check(out, argv[1]);
+
+    PackHeader header = { .version = PACK_VERSION, .entryCount = (uint32_t)count };
+    memcpy(header.magic, PACK_MAGIC, 4);
+
+    safe_write(&header, sizeof(header), 1, out);
+    safe_write(entries, sizeof(PackEntry), count, out);
+
+    static const uint8_t zeros[PACK_ALIGNMENT];
+
+    uint8_t *buffer = malloc(largest);
+    malloc_check(buffer);
+
+    uint64_t written = sizeof(PackHeader) + sizeof(PackEntry) * count;
+
+    for (int i = 0; i < count; ++i) {
+        safe_write(zeros, 1, entries[i].offset - written, out);
+
+        FILE *file = fopen(entries[i].path, "rb");
+        file_check(file, entries[i].path);
+        safe_read(buffer, 1, entries[i].size, file);
+        fclose(file);
+
+        safe_write(buffer, 1, entries[i].size, out);
+        written = entries[i].offset + entries[i].size;
+    }
+
+    fclose(out);
+
+    printf("%d files, %llu bytes\n", count, (unsigned long long)written);
+
+    free(buffer);
+    free(entries);
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+#include "program_cache.h"
+
+#include "bag_engine.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    /* NOTE: of the vendor, renderer and version strings */
+    uint64_t driverHash;
+    uint32_t entryCount;
+    uint32_t reserved;
+} ProgramCacheHeader;
+
+/* NOTE: followed by `size` bytes of the binary */
+typedef struct
+{
+    uint64_t key;
+    uint32_t format;
+    uint32_t size;
+} ProgramCacheEntry;
+
+static_assert(sizeof(ProgramCacheHeader) == 24, "ProgramCacheHeader has to be tightly packed");
+static_assert(sizeof(ProgramCacheEntry) == 16, "ProgramCacheEntry has to be tightly packed");
+
+typedef struct
+{
+    ProgramCacheEntry entry;
+    uint8_t *binary;
+    bool used;
+} CachedProgram;
+
+typedef struct
+{
+    const char *vertexPath;
+    const char *fragmentPath;
+    double seconds;
+    bool cached;
+} ProgramTiming;
+
+static CachedProgram cachedPrograms[MAX_CACHED_PROGRAM_COUNT];
+static int cachedProgramCount;
+static bool cacheLoaded;
+static bool cacheChanged;
+static uint64_t driverHash;
+
+static ProgramTiming timings[MAX_CACHED_PROGRAM_COUNT];
+static int timingCount;
+
+
+static uint64_t hashDriver(void)
+{
+    GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    uint64_t hash = HASH_SEED;
+
+    for (unsigned i = 0; i < length(names); ++i) {
+        const char *string = (const char *)glGetString(names[i]);
+        if (string)
+            hash = hashBytes(hash, string, strlen(string) + 1);
+    }
+
+    return hash;
+}
+
+
+static void loadCache(void)
+{
+    cacheLoaded = true;
+    driverHash  = hashDriver();
+
+    FILE *file = fopen(PROGRAM_CACHE_FILE, "rb");
+    if (!file)
+        return;
+
+    ProgramCacheHeader header;
+
+    if (fread(&header, sizeof(header), 1, file) != 1
+     || memcmp(header.magic, PROGRAM_CACHE_MAGIC, 4)
+     || header.version != PROGRAM_CACHE_VERSION
+     || header.driverHash != driverHash
+     || header.entryCount > MAX_CACHED_PROGRAM_COUNT) {
+        /* NOTE: a new driver, everything gets compiled and the file rewritten */
+        cacheChanged = true;
+        fclose(file);
+        return;
+    }
+
+    for (uint32_t i = 0; i < header.entryCount; ++i) {
+        CachedProgram *cached = cachedPrograms + cachedProgramCount;
+
+        if (fread(&cached->entry, sizeof(cached->entry), 1, file) != 1)
+            break;
+
+        cached->binary = malloc(cached->entry.size ? cached->entry.size : 1);
+        malloc_check(cached->binary);
+
+        if (fread(cached->binary, 1, cached->entry.size, file) != cached->entry.size) {
+            free(cached->binary);
+            break;
+        }
+
+        ++cachedProgramCount;
+    }
+
+    if (cachedProgramCount != (int)header.entryCount) {
+        fprintf(stderr, "Broken program cache \"%s\", compiling what's missing\n", PROGRAM_CACHE_FILE);
+        cacheChanged = true;
+    }
+
+    fclose(file);
+}
+
+
+static CachedProgram *findCached(uint64_t key)
+{
+    for (int i = 0; i < cachedProgramCount; ++i)
+        if (cachedPrograms[i].entry.key == key)
+            return cachedPrograms + i;
+
+    return NULL;
+}
+
+
+bool programCacheFind(uint64_t key, unsigned program)
+{
+    if (!cacheLoaded)
+        loadCache();
+
+    CachedProgram *cached = findCached(key);
+    if (!cached)
+        return false;
+
+    glProgramBinary(program, cached->entry.format, cached->binary, (GLsizei)cached->entry.size);
+
+    /* NOTE: the driver may still refuse it, the program gets compiled and stored again */
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+        return false;
+
+    cached->used = true;
+    return true;
+}
+
+
+void programCacheStore(uint64_t key, unsigned program)
+{
+    if (!cacheLoaded)
+        loadCache();
+
+    int size;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+
+    /* NOTE: drivers without any binary formats give 0 */
+    if (size <= 0)
+        return;
+
+    CachedProgram *cached = findCached(key);
+
+    if (!cached) {
+        if (cachedProgramCount == MAX_CACHED_PROGRAM_COUNT)
+            return;
+        cached = cachedPrograms + cachedProgramCount++;
+    } else {
+        free(cached->binary);
+    }
+
+    cached->binary = malloc((size_t)size);
+    malloc_check(cached->binary);
+
+    GLenum format;
+    glGetProgramBinary(program, size, &size, &format, cached->binary);
+
+    cached->entry = (ProgramCacheEntry) { key, format, (uint32_t)size };
+    cached->used  = true;
+
+    cacheChanged = true;
+}
+
+
+void programCacheTiming(const char *vertexPath, const char *fragmentPath, double seconds, bool cached)
+{
+    if (timingCount < MAX_CACHED_PROGRAM_COUNT)
+        timings[timingCount++] = (ProgramTiming) { vertexPath, fragmentPath, seconds, cached };
+}
+
+
+static void printTimings(void)
+{
+    double total = 0.0;
+    int cachedCount = 0;
+
+    for (int i = 0; i < timingCount; ++i) {
+        total += timings[i].seconds;
+        cachedCount += timings[i].cached;
+    }
+
+    printf("created %d shader programs in %.1f ms, %d from the program cache\n",
+           timingCount, total * 1e3, cachedCount);
+
+    for (int i = 0; i < timingCount; ++i) {
+        printf("  %8.2f ms  %-8s %s %s\n", timings[i].seconds * 1e3,
+               timings[i].cached ? "cached" : "compiled",
+               timings[i].vertexPath, timings[i].fragmentPath);
+    }
+
+    timingCount = 0;
+}
+
+
+void programCacheSave(void)
+{
+    printTimings();
+
+    /* NOTE: programs nobody asked for this time are left out */
+    int usedCount = 0;
+    for (int i = 0; i < cachedProgramCount; ++i)
+        usedCount += cachedPrograms[i].used;
+
+    if (!cacheChanged && usedCount == cachedProgramCount)
+        return;
+
+    FILE *file = fopen(PROGRAM_CACHE_FILE, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to write the program cache \"%s\"\n", PROGRAM_CACHE_FILE);
+        return;
+    }
+
+    ProgramCacheHeader header = {
+        .version    = PROGRAM_CACHE_VERSION,
+        .driverHash = driverHash,
+        .entryCount = (uint32_t)usedCount,
+    };
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, 4);
+
+    safe_write(&header, sizeof(header), 1, file);
+
+    for (int i = 0; i < cachedProgramCount; ++i) {
+        if (!cachedPrograms[i].used)
+            continue;
+
+        safe_write(&cachedPrograms[i].entry, sizeof(ProgramCacheEntry), 1, file);
+        safe_write(cachedPrograms[i].binary, 1, cachedPrograms[i].entry.size, file);
+    }
+
+    fclose(file);
+
+    cacheChanged = false;
+}
@@ -0,0 +1,25 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* NOTE: linked program binaries from glGetProgramBinary, in the working directory
+ *       next to the settings file, thrown away whole when the driver changes */
+#define PROGRAM_CACHE_FILE    "program_cache"
+#define PROGRAM_CACHE_MAGIC   "BRPC"
+#define PROGRAM_CACHE_VERSION 1
+
+#define MAX_CACHED_PROGRAM_COUNT 32
+
+/* NOTE: `key` hashes the sources, false when `program` has to be compiled after all */
+bool programCacheFind(uint64_t key, unsigned program);
+/* NOTE: `program` has to be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT */
+void programCacheStore(uint64_t key, unsigned program);
+
+void programCacheTiming(const char *vertexPath, const char *fragmentPath, double seconds, bool cached);
+
+/* NOTE: writes the file when anything changed and prints the timings */
+void programCacheSave(void);
+
+#endif
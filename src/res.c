@@ -1,31 +1,102 @@
 #include "res.h"
 
 #include "utils.h"
+#include "pack.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* NOTE: walks an asset in place, arrays are handed out as pointers into it */
+typedef struct
+{
+    const char *path;
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+} Reader;
+
+
+static const void *readArray(Reader *reader, size_t size, int count)
+{
+    if (count < 0 || (size_t)count > (reader->size - reader->offset) / size) {
+        fprintf(stderr, "%s:%d: read past the end! path: \"%s\".\n", __FILE__, __LINE__, reader->path);
+        exit(666);
+    }
+
+    const void *data = reader->data + reader->offset;
+    reader->offset += size * count;
+    return data;
+}
+
+
+/* NOTE: for what doesn't stay aligned, like anything after 16 bit keys */
+static void readCopy(Reader *reader, void *buffer, size_t size, int count)
+{
+    memcpy(buffer, readArray(reader, size, count), size * count);
+}
+
+
+static int readInt(Reader *reader)
+{
+    int value;
+    readCopy(reader, &value, sizeof(int), 1);
+    return value;
+}
+
+
+static void readEnd(const Reader *reader)
+{
+    if (reader->offset != reader->size) {
+        fprintf(stderr, "%s:%d: expected EOF! path: \"%s\".\n", __FILE__, __LINE__, reader->path);
+        exit(666);
+    }
+}
+
 
 Model modelLoad(const char *path)
 {
-    Model model;
-    FILE *file = fopen(path, "rb");
-    file_check(file, path);
+    Asset asset = assetLoad(path);
+    Reader reader = { path, asset.data, asset.size, 0 };
+
+    Model model = { .block = asset.block };
+
+    model.vertexCount = readInt(&reader);
+    model.indexCount  = readInt(&reader);
+
+    model.vertices = readArray(&reader, sizeof(Vertex), model.vertexCount);
+    model.indices  = readArray(&reader, sizeof(unsigned), model.indexCount);
 
-    safe_read(&model.vertexCount, sizeof(int), 1, file);
-    safe_read(&model.indexCount, sizeof(int), 1, file);
+    if (reader.offset != reader.size) {
+        if (memcmp(readArray(&reader, 4, 1), MODEL_LODS_MAGIC, 4)) {
+            fprintf(stderr, "%s:%d: expected LODs! path: \"%s\".\n", __FILE__, __LINE__, path);
+            exit(666);
+        }
 
-    model.vertices = malloc(sizeof(Vertex) * model.vertexCount);
-    malloc_check(model.vertices);
+        model.lodCount = readInt(&reader);
+        if (model.lodCount > MAX_MODEL_LOD_COUNT) {
+            fprintf(stderr, "%s:%d: too many LODs! path: \"%s\".\n", __FILE__, __LINE__, path);
+            exit(666);
+        }
 
-    model.indices = malloc(sizeof(unsigned) * model.indexCount);
-    malloc_check(model.indices);
+        model.lods = readArray(&reader, sizeof(ModelLod), model.lodCount);
 
-    safe_read(model.vertices, sizeof(Vertex), model.vertexCount, file);
-    safe_read(model.indices, sizeof(unsigned), model.indexCount, file);
+        int lodIndexCount = 0;
+        for (int i = 0; i < model.lodCount; ++i) {
+            if (model.lods[i].indexCount < 0 || model.lods[i].indexCount > model.indexCount) {
+                fprintf(stderr, "%s:%d: LOD bigger than the model! path: \"%s\".\n", __FILE__, __LINE__, path);
+                exit(666);
+            }
+            lodIndexCount += model.lods[i].indexCount;
+        }
 
-    eof_check(file);
+        model.lodIndices = readArray(&reader, sizeof(unsigned), lodIndexCount);
+    }
+
+    readEnd(&reader);
 
-    fclose(file);
     return model;
 }
 
@@ -60,74 +131,190 @@ void modelPrint(const Model *model)
 
 void modelFree(Model model)
 {
-    free(model.vertices);
-    free(model.indices);
+    free(model.block);
+}
+
+
+/* NOTE: `boneCount` has to be set, the hierarchy of a single tree holds boneCount - 1 ids */
+static void armatureAllocate(Armature *armature, unsigned keyCount, unsigned keyTimeCount)
+{
+    size_t bones = armature->boneCount;
+
+    size_t size = (sizeof(Matrix) + sizeof(DualQuaternion)) * bones
+                + (sizeof(JointTransform) + sizeof(float)) * keyCount
+                + sizeof(float) * keyTimeCount
+                + sizeof(unsigned) * (5 * bones - 1);
+
+    char *block = malloc(size);
+    malloc_check(block);
+
+    armature->ibms         = (Matrix *)block;           block += sizeof(Matrix) * bones;
+    armature->ibdqs        = (DualQuaternion *)block;   block += sizeof(DualQuaternion) * bones;
+    armature->transforms   = (JointTransform *)block;   block += sizeof(JointTransform) * keyCount;
+    armature->timeStamps   = (float *)block;            block += sizeof(float) * keyCount;
+    armature->keyTimes     = (float *)block;            block += sizeof(float) * keyTimeCount;
+    armature->frameCounts  = (unsigned *)block;         block += sizeof(unsigned) * bones;
+    armature->frameOffsets = (unsigned *)block;         block += sizeof(unsigned) * bones;
+    armature->childCounts  = (unsigned *)block;         block += sizeof(unsigned) * bones;
+    armature->childOffsets = (unsigned *)block;         block += sizeof(unsigned) * bones;
+    armature->hierarchy    = (unsigned *)block;
+}
+
+
+static unsigned computeOffsets(unsigned *offsets, const unsigned *counts, int count)
+{
+    unsigned total = 0;
+    for (int i = 0; i < count; ++i) {
+        offsets[i] = total;
+        total += counts[i];
+    }
+    return total;
+}
+
+
+/* NOTE: smallest three, the index of the dropped component is in the top bits of the first two */
+static Quaternion dequantizeRotation(const uint16_t quantized[3])
+{
+    const float range = 0.70710678f; /* 1 / sqrt(2) */
+    const float scale = range * 2.0f / 32767.0f;
+
+    unsigned largest = (quantized[0] >> 15) << 1 | quantized[1] >> 15;
+
+    float rest[3];
+    float sum = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        rest[i] = (quantized[i] & 0x7fff) * scale - range;
+        sum += rest[i] * rest[i];
+    }
+
+    Quaternion rotation;
+    for (unsigned i = 0, j = 0; i < 4; ++i)
+        rotation.data[i] = i == largest ? sqrtf(fmaxf(1.0f - sum, 0.0f)) : rest[j++];
+
+    return rotation;
+}
+
+
+static void animatedLoadFrames(Armature *armature, Reader *reader)
+{
+    const unsigned *frameCounts = readArray(reader, sizeof(unsigned), armature->boneCount);
+
+    unsigned keyCount = 0;
+    for (int i = 0; i < armature->boneCount; ++i)
+        keyCount += frameCounts[i];
+
+    armatureAllocate(armature, keyCount, 0);
+    memcpy(armature->frameCounts, frameCounts, sizeof(unsigned) * armature->boneCount);
+
+    computeOffsets(armature->frameOffsets, armature->frameCounts, armature->boneCount);
+
+    readCopy(reader, armature->timeStamps, sizeof(float), (int)keyCount);
+    readCopy(reader, armature->transforms, sizeof(JointTransform), (int)keyCount);
+
+    /* NOTE: uncompressed files key every bone at the same times */
+    armature->keyTimeCount = armature->frameCounts[0];
+    armature->keyTimes = armature->timeStamps;
+}
+
+
+static void animatedLoadCompressedFrames(Armature *armature, unsigned keyCount, int reducedCount, Reader *reader)
+{
+    readCopy(reader, armature->keyTimes, sizeof(float), armature->keyTimeCount);
+
+    /* NOTE: the keys index the times left after deduplication, not the clip times */
+    const float *reducedTimes = readArray(reader, sizeof(float), reducedCount);
+
+    readCopy(reader, armature->frameCounts, sizeof(unsigned), armature->boneCount);
+
+    if (computeOffsets(armature->frameOffsets, armature->frameCounts, armature->boneCount) != keyCount) {
+        fprintf(stderr, "%s:%d: key count mismatch! exiting...\n", __FILE__, __LINE__);
+        exit(666);
+    }
+
+    const float (*bounds)[6] = (const float (*)[6])readArray(reader, sizeof(*bounds), armature->boneCount);
+    const uint16_t (*keys)[7] = (const uint16_t (*)[7])readArray(reader, sizeof(*keys), (int)keyCount);
+
+    for (int i = 0; i < armature->boneCount; ++i) {
+        const float *low = bounds[i];
+        const float *extent = bounds[i] + 3;
+
+        for (unsigned j = armature->frameOffsets[i]; j < armature->frameOffsets[i] + armature->frameCounts[i]; ++j) {
+            if (keys[j][0] >= reducedCount) {
+                fprintf(stderr, "%s:%d: key time out of range! exiting...\n", __FILE__, __LINE__);
+                exit(666);
+            }
+
+            armature->timeStamps[j] = reducedTimes[keys[j][0]];
+            armature->transforms[j].rotation = dequantizeRotation(keys[j] + 1);
+            for (int k = 0; k < 3; ++k)
+                armature->transforms[j].position[k] = low[k] + keys[j][4 + k] * (extent[k] / 65535.0f);
+            armature->transforms[j].position[3] = 1.0f;
+        }
+    }
 }
 
 
 Animated animatedLoad(const char *path)
 {
-    Animated animated;
-
-    FILE *file = fopen(path, "rb");
-    file_check(file, path);
-
-    safe_read(&animated.model.vertexCount, sizeof(int), 1, file);
-    safe_read(&animated.model.indexCount, sizeof(int), 1, file);
-    safe_read(&animated.armature.boneCount, sizeof(int), 1, file);
-
-    animated.model.vertices = malloc(sizeof(Vertex) * animated.model.vertexCount);
-    animated.model.indices = malloc(sizeof(unsigned) * animated.model.indexCount);
-    malloc_check(animated.model.vertices);
-    malloc_check(animated.model.indices);
-    safe_read(animated.model.vertices, sizeof(Vertex), animated.model.vertexCount, file);
-    safe_read(animated.model.indices, sizeof(unsigned), animated.model.indexCount, file);
-
-    animated.vertexWeights = malloc(sizeof(VertexWeight) * animated.model.vertexCount);
-    animated.armature.ibms = malloc(sizeof(Matrix) * animated.armature.boneCount);
-    malloc_check(animated.vertexWeights);
-    malloc_check(animated.armature.ibms);
-    safe_read(animated.vertexWeights, sizeof(VertexWeight), animated.model.vertexCount, file);
-    safe_read(animated.armature.ibms, sizeof(Matrix), animated.armature.boneCount, file);
-
-    animated.armature.frameCounts = malloc(sizeof(unsigned) * animated.armature.boneCount);
-    animated.armature.frameOffsets = malloc(sizeof(unsigned) * animated.armature.boneCount);
-    malloc_check(animated.armature.frameCounts);
-    malloc_check(animated.armature.frameOffsets);
-    safe_read(animated.armature.frameCounts, sizeof(unsigned), animated.armature.boneCount, file);
-
-    int frameCount = 0;
-    for (int i = 0; i < animated.armature.boneCount; ++i) {
-        animated.armature.frameOffsets[i] = frameCount;
-        frameCount += animated.armature.frameCounts[i];
+    Asset asset = assetLoad(path);
+    Reader reader = { path, asset.data, asset.size, 0 };
+
+    Animated animated = { .model.block = asset.block };
+
+    bool compressed = asset.size >= 4 && !memcmp(asset.data, ANIMATED_COMPRESSED_MAGIC, 4);
+    if (compressed)
+        reader.offset = 4;
+
+    animated.model.vertexCount  = readInt(&reader);
+    animated.model.indexCount   = readInt(&reader);
+    animated.armature.boneCount = readInt(&reader);
+
+    if (animated.armature.boneCount < 1) {
+        fprintf(stderr, "%s:%d: armature without bones! path: \"%s\".\n", __FILE__, __LINE__, path);
+        exit(666);
     }
 
-    animated.armature.timeStamps = malloc(sizeof(float) * frameCount);
-    animated.armature.transforms = malloc(sizeof(JointTransform) * frameCount);
-    malloc_check(animated.armature.timeStamps);
-    malloc_check(animated.armature.transforms);
-    safe_read(animated.armature.timeStamps, sizeof(float), frameCount, file);
-    safe_read(animated.armature.transforms, sizeof(JointTransform), frameCount, file);
-
-    animated.armature.childCounts = malloc(sizeof(unsigned) * animated.armature.boneCount);
-    animated.armature.childOffsets = malloc(sizeof(unsigned) * animated.armature.boneCount);
-    malloc_check(animated.armature.childCounts);
-    malloc_check(animated.armature.childOffsets);
-    safe_read(animated.armature.childCounts, sizeof(unsigned), animated.armature.boneCount, file);
-
-    int childrenCount = 0;
-    for (int i = 0; i < animated.armature.boneCount; ++i) {
-        animated.armature.childOffsets[i] = childrenCount;
-        childrenCount += animated.armature.childCounts[i];
+    int reducedCount = 0, keyCount = 0;
+    if (compressed) {
+        animated.armature.keyTimeCount = readInt(&reader);
+        reducedCount = readInt(&reader);
+        keyCount = readInt(&reader);
     }
 
-    animated.armature.hierarchy = malloc(sizeof(unsigned) * childrenCount);
-    malloc_check(animated.armature.hierarchy);
-    safe_read(animated.armature.hierarchy, sizeof(unsigned), childrenCount, file);
+    animated.model.vertices = readArray(&reader, sizeof(Vertex), animated.model.vertexCount);
+    animated.model.indices  = readArray(&reader, sizeof(unsigned), animated.model.indexCount);
+    animated.vertexWeights  = readArray(&reader, sizeof(VertexWeight), animated.model.vertexCount);
 
-    eof_check(file);
+    const void *ibms = readArray(&reader, sizeof(Matrix), animated.armature.boneCount);
+
+    if (compressed) {
+        armatureAllocate(&animated.armature, keyCount, animated.armature.keyTimeCount);
+        animatedLoadCompressedFrames(&animated.armature, keyCount, reducedCount, &reader);
+    } else {
+        animatedLoadFrames(&animated.armature, &reader);
+    }
+
+    memcpy(animated.armature.ibms, ibms, sizeof(Matrix) * animated.armature.boneCount);
+
+    for (int i = 0; i < animated.armature.boneCount; ++i)
+        animated.armature.ibdqs[i] = matrixToDualQuaternion(animated.armature.ibms + i);
+
+    readCopy(&reader, animated.armature.childCounts, sizeof(unsigned), animated.armature.boneCount);
+
+    unsigned childrenCount = computeOffsets(
+            animated.armature.childOffsets,
+            animated.armature.childCounts,
+            animated.armature.boneCount
+    );
+    if (childrenCount != (unsigned)animated.armature.boneCount - 1) {
+        fprintf(stderr, "%s:%d: armature is not a single tree! path: \"%s\".\n", __FILE__, __LINE__, path);
+        exit(666);
+    }
+
+    readCopy(&reader, animated.armature.hierarchy, sizeof(unsigned), childrenCount);
+
+    readEnd(&reader);
 
-    fclose(file);
     return animated;
 }
 
@@ -135,17 +322,10 @@ Animated animatedLoad(const char *path)
 void animatedFree(Animated animated)
 {
     modelFree(animated.model);
-    free(animated.vertexWeights);
-    free(animated.armature.ibms);
     armatureFree(animated.armature);
 }
 
 void armatureFree(Armature armature)
 {
-    free(armature.frameCounts);
-    free(armature.timeStamps);
-    free(armature.transforms);
-    free(armature.childCounts);
-    free(armature.hierarchy);
+    free(armature.ibms);
 }
-
@@ -11,12 +11,34 @@ typedef struct
 } Vertex;
 
 
+/* NOTE: written after a model's indices by `model_optimizer --lods`, followed by the
+ *       lod count, a ModelLod for each and their indices one level after another */
+#define MODEL_LODS_MAGIC "LODS"
+/* NOTE: simplified levels, not counting the full one */
+#define MAX_MODEL_LOD_COUNT 3
+
+typedef struct
+{
+    int indexCount;
+    /* NOTE: in model units, roughly how far the surface moved at worst */
+    float error;
+} ModelLod;
+
+
+/* NOTE: loaded arrays point into the asset pack, or into `block` for loose files */
 typedef struct
 {
     int vertexCount;
     int indexCount;
-    Vertex *vertices;
-    unsigned *indices;
+    const Vertex *vertices;
+    const unsigned *indices;
+
+    /* NOTE: each level indexes the same vertices, coarser ones later */
+    int lodCount;
+    const ModelLod *lods;
+    const unsigned *lodIndices;
+
+    void *block;
 } Model;
 
 
@@ -34,28 +56,35 @@ typedef struct
 } JointTransform;
 
 
+/* NOTE: every array lives in one allocation starting at `ibms` */
 typedef struct
 {
     int boneCount;
+    int keyTimeCount;
 
     Matrix *ibms;
+    DualQuaternion *ibdqs;
 
     unsigned *frameCounts;
     unsigned *frameOffsets;
     float *timeStamps;
     JointTransform *transforms;
 
+    /* the frame times of the clips, shared by all bones */
+    float *keyTimes;
+
     unsigned *childCounts;
     unsigned *childOffsets;
     unsigned *hierarchy;
 } Armature;
 
 
+/* NOTE: the weights are next to the model's arrays, freed with it */
 typedef struct
 {
     Model model;
     Armature armature;
-    VertexWeight *vertexWeights;
+    const VertexWeight *vertexWeights;
 } Animated;
 
 
@@ -63,6 +92,9 @@ Model modelLoad(const char *path);
 void modelPrint(const Model *model);
 void modelFree(Model model);
 
+/* NOTE: prefix of files written by `dae_parser.py --compress` */
+#define ANIMATED_COMPRESSED_MAGIC "ANMC"
+
 Animated animatedLoad(const char *path);
 void animatedFree(Animated animated);
 
@@ -4,6 +4,7 @@
 #include "gui.h"
 #include "audio.h"
 #include "settings.h"
+#include "loader.h"
 
 #include <assert.h>
 
@@ -97,10 +98,10 @@ void initSplash(void)
         .rx = 0.0f, .ry = (float)(-M_PI / 2.0 + 0.5), .rz = 0.0f
     };
 
-    brugTexture = createTexture("res/brug.png");
-    brugModel   = loadModelObject("res/brug_pose.model");
+    loadTextureAsync(&brugTexture, "res/brug.png");
+    loadModelAsync(&brugModel, "res/brug_pose.model");
 
-    envMap = createCubeTexture(
+    loadCubeTextureAsync(&envMap, (const char *[6]) {
             "res/Maskonaive2/posx.png",
             "res/Maskonaive2/negx.png",
 
@@ -109,7 +110,7 @@ void initSplash(void)
 
             "res/Maskonaive2/posz.png",
             "res/Maskonaive2/negz.png"
-    );
+    });
 
     if (gameState.isEditor)
         buttonNames[SplashNewGame] = "   EDIT   ";
@@ -370,13 +371,11 @@ void splashProcessMouse(bagE_Mouse *m)
             if (i == selectedButton)
                 return;
 
-            playSound((Sound) {
-                .data  = game.sounds[VineThudSound],
-                .end   = game.soundLengths[VineThudSound] / 16,
-                .volL  = 0.15f,
-                .volR  = 0.15f,
-                .times = 1,
-            });
+            /* NOTE: kept even, so it ends on a whole frame */
+            Sound sound = gameSound(VineThudSound);
+            sound.end  = sound.end / 16 & ~(size_t)1;
+            sound.volL = sound.volR = 0.15f;
+            playSound(sound);
 
             selectedButton = i;
             return;
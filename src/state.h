@@ -49,6 +49,7 @@ typedef struct
     bool inSplash;
     bool isEditor;
     bool isPaused;
+    bool debugOverlay;
     float sensitivity;
 } GameState;
 
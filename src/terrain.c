@@ -6,17 +6,21 @@
 #define CHUNK_VERTEX_COUNT (CHUNK_DIM * CHUNK_DIM * 4)
 #define CHUNK_INDEX_COUNT  (CHUNK_DIM * CHUNK_DIM * 6)
 
-static Vertex   vertexBuffer[CHUNK_VERTEX_COUNT];
-static unsigned indexBuffer[CHUNK_INDEX_COUNT];
-static float    normalBuffer[(CHUNK_DIM + 1) * (CHUNK_DIM + 1) * 3];
 
 void updateChunkObject(
         ChunkObject *chunkObject,
         const Terrain *terrain,
         const AtlasView *atlasViews,
         int cx,
-        int cz
+        int cz,
+        Arena *scratch
 ) {
+    size_t scratchMark = arenaMark(scratch);
+
+    Vertex   *vertexBuffer = arenaAlloc(scratch, sizeof(Vertex)   * CHUNK_VERTEX_COUNT);
+    unsigned *indexBuffer  = arenaAlloc(scratch, sizeof(unsigned) * CHUNK_INDEX_COUNT);
+    float    *normalBuffer = arenaAlloc(scratch, sizeof(float)    * (CHUNK_DIM + 1) * (CHUNK_DIM + 1) * 3);
+
     int vertexCount = 0;
     int indexCount = 0;
 
@@ -169,6 +173,8 @@ discard_tile:
     glNamedBufferSubData(chunkObject->ebo, 0, indexCount  * sizeof(unsigned), indexBuffer);
     chunkObject->vertexCount = vertexCount;
     chunkObject->indexCount  = indexCount ;
+
+    arenaRewind(scratch, scratchMark);
 }
 
 
@@ -217,10 +223,8 @@ static TerrainLocation maybeCreateChunk(Terrain *terrain, int x, int z)
         chunkID = terrain->chunkCount++;
         terrain->chunkMap[chunkPos] = chunkID;
 
-        ChunkHeights  *chunkHeights  = malloc(sizeof(ChunkHeights));
-        ChunkTextures *chunkTextures = malloc(sizeof(ChunkTextures));
-        malloc_check(chunkHeights);
-        malloc_check(chunkTextures);
+        ChunkHeights  *chunkHeights  = arenaAlloc(terrain->arena, sizeof(ChunkHeights));
+        ChunkTextures *chunkTextures = arenaAlloc(terrain->arena, sizeof(ChunkTextures));
 
         for (int i = 0; i < CHUNK_DIM * CHUNK_DIM; ++i)
             chunkHeights->data[i] = NO_TILE;
@@ -268,9 +272,10 @@ void terrainClearChunkMap(Terrain *terrain)
 }
 
 
-void terrainLoad(Terrain *terrain, FILE *file)
+void terrainLoad(Terrain *terrain, FILE *file, Arena *arena)
 {
     terrainClearChunkMap(terrain);
+    terrain->arena = arena;
 
     char buffer[4];
     safe_read(buffer, 1, 4, file);
@@ -287,13 +292,11 @@ void terrainLoad(Terrain *terrain, FILE *file)
         safe_read(&cz, sizeof(int), 1, file);
         terrain->chunkMap[cz * MAX_MAP_DIM + cx] = i;
 
-        ChunkHeights *heights = malloc(sizeof(ChunkHeights));
-        malloc_check(heights);
+        ChunkHeights *heights = arenaAlloc(arena, sizeof(ChunkHeights));
         safe_read(heights, sizeof(ChunkHeights), 1, file);
         terrain->heights[i] = heights;
 
-        ChunkTextures *textures = malloc(sizeof(ChunkTextures));
-        malloc_check(textures);
+        ChunkTextures *textures = arenaAlloc(arena, sizeof(ChunkTextures));
         safe_read(textures, sizeof(ChunkTextures), 1, file);
         terrain->textures[i] = textures;
 
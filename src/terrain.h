@@ -2,6 +2,7 @@
 #define TERRAIN_H
 
 #include "res.h"
+#include "arena.h"
 
 #include "bag_engine.h"
 
@@ -79,16 +80,10 @@ typedef struct
     ChunkTextures *textures[MAX_MAP_DIM * MAX_MAP_DIM];
     ChunkObject objects[MAX_MAP_DIM * MAX_MAP_DIM];
     int chunkCount;
+    /* NOTE: the chunk data lives here, it goes with the arena's reset */
+    Arena *arena;
 } Terrain;
 
-static inline void terrainFreeChunkData(Terrain *terrain)
-{
-    for (int i = 0; i < terrain->chunkCount; ++i) {
-        free(terrain->heights[i]);
-        free(terrain->textures[i]);
-    }
-}
-
 static inline void terrainFreeChunkObjects(Terrain *terrain)
 {
     for (int i = 0; i < terrain->chunkCount; ++i) {
@@ -143,10 +138,12 @@ void updateChunkObject(
         const Terrain *terrain,
         const AtlasView *atlasViews,
         int cx,
-        int cz
+        int cz,
+        Arena *scratch
 );
 
-void terrainLoad(Terrain *terrain, FILE *file);
+/* NOTE: the chunks are allocated from `arena`, so are the ones the editor adds later */
+void terrainLoad(Terrain *terrain, FILE *file, Arena *arena);
 void terrainSave(Terrain *terrain, FILE *file);
 
 #endif
@@ -0,0 +1,95 @@
+#include "texture.h"
+
+#include "utils.h"
+
+#include <string.h>
+
+
+static int levelSize(int size, int level)
+{
+    size >>= level;
+    return size ? size : 1;
+}
+
+
+uint64_t textureHash(const uint8_t *data, size_t size)
+{
+    return hashBytes(HASH_SEED, data, size);
+}
+
+
+int textureLevelCount(int width, int height)
+{
+    int levelCount = 1;
+
+    while (levelSize(width, levelCount - 1) > 1 || levelSize(height, levelCount - 1) > 1)
+        ++levelCount;
+
+    return levelCount;
+}
+
+
+size_t textureLevelsSize(int width, int height, int levelCount)
+{
+    size_t size = 0;
+
+    for (int level = 0; level < levelCount; ++level)
+        size += (size_t)levelSize(width, level) * levelSize(height, level) * 4;
+
+    return size;
+}
+
+
+void textureBuildLevels(uint8_t *levels, int width, int height, int levelCount)
+{
+    const uint8_t *source = levels;
+
+    for (int level = 1; level < levelCount; ++level) {
+        int sourceWidth  = levelSize(width,  level - 1);
+        int sourceHeight = levelSize(height, level - 1);
+        int targetWidth  = levelSize(width,  level);
+        int targetHeight = levelSize(height, level);
+
+        uint8_t *target = (uint8_t *)source + (size_t)sourceWidth * sourceHeight * 4;
+
+        for (int y = 0; y < targetHeight; ++y) {
+            /* NOTE: odd edges repeat the last row or column */
+            int y0 = 2 * y < sourceHeight ? 2 * y : sourceHeight - 1;
+            int y1 = 2 * y + 1 < sourceHeight ? 2 * y + 1 : sourceHeight - 1;
+
+            for (int x = 0; x < targetWidth; ++x) {
+                int x0 = 2 * x < sourceWidth ? 2 * x : sourceWidth - 1;
+                int x1 = 2 * x + 1 < sourceWidth ? 2 * x + 1 : sourceWidth - 1;
+
+                const uint8_t *a = source + ((size_t)y0 * sourceWidth + x0) * 4;
+                const uint8_t *b = source + ((size_t)y0 * sourceWidth + x1) * 4;
+                const uint8_t *c = source + ((size_t)y1 * sourceWidth + x0) * 4;
+                const uint8_t *d = source + ((size_t)y1 * sourceWidth + x1) * 4;
+
+                uint8_t *pixel = target + ((size_t)y * targetWidth + x) * 4;
+
+                for (int i = 0; i < 4; ++i)
+                    pixel[i] = (uint8_t)((a[i] + b[i] + c[i] + d[i] + 2) / 4);
+            }
+        }
+
+        source = target;
+    }
+}
+
+
+bool textureCookedPath(char *cooked, size_t size, const char *path)
+{
+    const char *dot   = strrchr(path, '.');
+    const char *slash = strrchr(path, '/');
+
+    size_t stem = dot && (!slash || dot > slash) ? (size_t)(dot - path) : strlen(path);
+
+    if (stem + sizeof(TEXTURE_EXTENSION) > size)
+        return false;
+
+    memcpy(cooked, path, stem);
+    memcpy(cooked + stem, TEXTURE_EXTENSION, sizeof(TEXTURE_EXTENSION));
+
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/* NOTE: a header and then every mip level of the RGBA image, largest first, written
+ *       by texture_cooker next to the image it was made from, "res/brug.tex" */
+#define TEXTURE_MAGIC     "BRTX"
+#define TEXTURE_VERSION   1
+#define TEXTURE_EXTENSION ".tex"
+
+typedef enum
+{
+    TextureFlipped = 1 << 0,
+} TextureFlags;
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    /* NOTE: of the image file as it is on disk, the game decodes it instead when it differs */
+    uint64_t sourceHash;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t flags;
+} TextureHeader;
+
+static_assert(sizeof(TextureHeader) == 32, "TextureHeader has to be tightly packed");
+
+
+uint64_t textureHash(const uint8_t *data, size_t size);
+
+/* NOTE: down to 1x1 */
+int textureLevelCount(int width, int height);
+size_t textureLevelsSize(int width, int height, int levelCount);
+/* NOTE: box filters each level from the one before, level 0 has to be there already */
+void textureBuildLevels(uint8_t *levels, int width, int height, int levelCount);
+
+/* NOTE: false when `cooked` is too small */
+bool textureCookedPath(char *cooked, size_t size, const char *path);
+
+#endif
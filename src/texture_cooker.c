@@ -0,0 +1,96 @@
+#include "texture.h"
+
+#include "pack.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+/* usage: texture_cooker [--cube] <images...>
+ *
+ * NOTE: run from the game directory, cube map faces aren't flipped like the rest so
+ *       they are cooked on their own, before the pack is built:
+ *       ./texture_cooker $(find res -maxdepth 1 -name '*.png')
+ *       ./texture_cooker --cube $(find res/Maskonaive2 -name '*.png') */
+
+
+static void cookTexture(const char *path, bool flip)
+{
+    char cookedPath[256];
+
+    if (!textureCookedPath(cookedPath, sizeof(cookedPath), path)) {
+        fprintf(stderr, "path too long: \"%s\"\n", path);
+        exit(666);
+    }
+
+    Asset source = assetLoad(path);
+
+    stbi_set_flip_vertically_on_load(flip);
+
+    int width, height, channelCount;
+    uint8_t *image = stbi_load_from_memory(source.data, (int)source.size, &width, &height, &channelCount, STBI_rgb_alpha);
+
+    if (!image) {
+        fprintf(stderr, "Failed to load image \"%s\": %s\n", path, stbi_failure_reason());
+        exit(666);
+    }
+
+    TextureHeader header = {
+        .version    = TEXTURE_VERSION,
+        .sourceHash = textureHash(source.data, source.size),
+        .width      = (uint32_t)width,
+        .height     = (uint32_t)height,
+        .levelCount = (uint32_t)textureLevelCount(width, height),
+        .flags      = flip ? TextureFlipped : 0,
+    };
+    memcpy(header.magic, TEXTURE_MAGIC, 4);
+
+    assetFree(source);
+
+    size_t size = textureLevelsSize(width, height, header.levelCount);
+
+    uint8_t *levels = malloc(size);
+    malloc_check(levels);
+
+    memcpy(levels, image, (size_t)width * height * 4);
+    stbi_image_free(image);
+
+    textureBuildLevels(levels, width, height, header.levelCount);
+
+    FILE *out = fopen(cookedPath, "wb");
+    file_check(out, cookedPath);
+
+    safe_write(&header, sizeof(header), 1, out);
+    safe_write(levels, 1, size, out);
+
+    fclose(out);
+    free(levels);
+
+    printf("%s: %dx%d, %u levels, %zu bytes\n", cookedPath, width, height, header.levelCount, sizeof(header) + size);
+}
+
+
+int main(int argc, char *argv[])
+{
+    bool flip = true;
+    int first = 1;
+
+    if (argc > 1 && !strcmp(argv[1], "--cube")) {
+        flip = false;
+        ++first;
+    }
+
+    if (argc <= first) {
+        fprintf(stderr, "usage: %s [--cube] <images...>\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = first; i < argc; ++i)
+        cookTexture(argv[i], flip);
+
+    return 0;
+}
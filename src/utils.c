@@ -1,8 +1,20 @@
+/* NOTE: for clock_gettime, the tools build this without it */
+#ifndef _POSIX_C_SOURCE
+    #define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "utils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
 /* WOAH */
 char *readFile(const char *name)
 {
@@ -59,3 +71,40 @@ error_exit:
     return NULL;
 }
 
+
+uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = data;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+
+uint64_t monotonicNanoseconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    /* NOTE: split so the multiplication doesn't overflow */
+    uint64_t whole = (uint64_t)(counter.QuadPart / frequency.QuadPart);
+    uint64_t part  = (uint64_t)(counter.QuadPart % frequency.QuadPart);
+    return whole * 1000000000ull + part * 1000000000ull / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+
+double monotonicSeconds(void)
+{
+    return monotonicNanoseconds() * 1e-9;
+}
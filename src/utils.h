@@ -2,6 +2,7 @@
 #define UTILS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -87,4 +88,12 @@
 
 char *readFile(const char *name);
 
+/* NOTE: FNV-1a, pass the last hash back in to hash more than one piece */
+#define HASH_SEED 14695981039346656037ull
+uint64_t hashBytes(uint64_t hash, const void *data, size_t size);
+
+/* NOTE: monotonic, from an unspecified point, only differences mean anything */
+uint64_t monotonicNanoseconds(void);
+double monotonicSeconds(void);
+
 #endif
@@ -63,7 +63,8 @@ static DWORD taskID;
 
 DWORD WINAPI audioThreadFunction(void *param)
 {
-    AudioWriteCallback writeCallback = ((AudioInfo*)param)->writeCallback;
+    AudioInfo *info = (AudioInfo*)param;
+    AudioWriteCallback writeCallback = info->writeCallback;
 
     HRESULT hr;
 
@@ -116,7 +117,8 @@ DWORD WINAPI audioThreadFunction(void *param)
 
     WAVEFORMATEX *closest;
 
-    REFERENCE_TIME requestedDuration = REFTIMES_PER_SEC / 8;
+    /* NOTE: shared mode doesn't go much under the engine period of ~10 ms */
+    REFERENCE_TIME requestedDuration = info->lowLatency ? REFTIMES_PER_SEC / 100 : REFTIMES_PER_SEC / 8;
     hr = audioClient->lpVtbl->IsFormatSupported(
             audioClient,
             AUDCLNT_SHAREMODE_SHARED,
@@ -187,13 +189,11 @@ DWORD WINAPI audioThreadFunction(void *param)
         log_on_fail(hr, "Failed to release buffer!");
     }
 
-#if 0
-    task = AvSetMmThreadCharacteristics(TEXT("Pro Audio"), &taskID);
-    if (task == NULL) {
-        fprintf(stderr, "Failed to set mm thread characteristics!\n");
-        exit(1);
+    if (info->realTime) {
+        task = AvSetMmThreadCharacteristics(TEXT("Pro Audio"), &taskID);
+        if (task == NULL)
+            log("Failed to set mm thread characteristics!\n");
     }
-#endif
 
     hr = audioClient->lpVtbl->Start(audioClient);
     kill_on_fail(hr, "Failed to audio client!\n");
@@ -206,6 +206,10 @@ DWORD WINAPI audioThreadFunction(void *param)
         hr = audioClient->lpVtbl->GetCurrentPadding(audioClient, &paddingFrames);
         log_on_fail(hr, "Failed to retrieve padding!\n");
 
+        /* NOTE: nothing left queued means the device ran dry */
+        if (SUCCEEDED(hr) && paddingFrames == 0)
+            audioReportXrun();
+
         unsigned framesToRender = bufferFrameCount - paddingFrames;
 
         if (SUCCEEDED(renderClient->lpVtbl->GetBuffer(renderClient, framesToRender, (BYTE**)&destBuffer))) {
@@ -213,6 +217,8 @@ DWORD WINAPI audioThreadFunction(void *param)
 
             hr = renderClient->lpVtbl->ReleaseBuffer(renderClient, framesToRender, 0);
             log_on_fail(hr, "Failed to release buffer!");
+
+            audioReportLatency(bufferFrameCount);
         }
     }
 }